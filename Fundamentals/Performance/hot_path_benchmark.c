@@ -0,0 +1,179 @@
+#include <bson/bson.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../perf_metrics.h"
+
+/*
+ * Benchmark harness for the ingest and migration hot paths. Generates
+ * synthetic traces at our production p50 shape (~40 attributes, ~1.8KB of
+ * BSON) and measures the CPU-only cost of the three operations every trace
+ * pays: JSON parse + validation, zero-copy BSON validation, and document
+ * build + dispatch. Inserts go to an in-memory mock collection so the Mongo
+ * round trip is excluded. Reports traces/sec, allocations/op, and p50/p99
+ * latency per operation; histograms are also dumped to benchmark_metrics.prom.
+ */
+
+#define BENCH_TRACES 100000
+#define BENCH_ATTRIBUTES 40
+
+static uint64_t bench_allocs = 0;
+
+static void* bench_malloc(size_t num_bytes) {
+    bench_allocs++;
+    return malloc(num_bytes);
+}
+
+static void* bench_calloc(size_t n_members, size_t num_bytes) {
+    bench_allocs++;
+    return calloc(n_members, num_bytes);
+}
+
+static void* bench_realloc(void *mem, size_t num_bytes) {
+    bench_allocs++;
+    return realloc(mem, num_bytes);
+}
+
+static void bench_free(void *mem) {
+    free(mem);
+}
+
+// In-memory stand-in for the traces collection: accepting a document costs a
+// length accumulation, nothing else.
+static size_t mock_collection_bytes = 0;
+
+static void mock_insert(const bson_t *doc) {
+    mock_collection_bytes += doc->len;
+}
+
+// Our p50 trace: trade_id, level, _time plus enough filler attributes to land
+// around 1.8KB of BSON.
+static char* make_trace_json(int seq) {
+    char *json = (char*)malloc(4096);
+    int offset = snprintf(json, 4096,
+        "{\"attributes\":{\"trade_id\":\"trade-%08d\",\"level\":\"info\",\"trade_type\":\"arbitrage\",\"chain\":\"sol\"",
+        seq);
+    for (int i = 0; i < BENCH_ATTRIBUTES - 4; i++) {
+        offset += snprintf(json + offset, 4096 - offset,
+            ",\"attr_%02d\":\"value-%08d-abcdefghijklmnopqrstuvwxyz\"", i, seq + i);
+    }
+    snprintf(json + offset, 4096 - offset, "},\"_time\":1697059200000}");
+    return json;
+}
+
+// Same checks the validator fast path runs.
+static int validate_doc(const bson_t *doc) {
+    bson_iter_t iter;
+    bson_iter_t descent;
+    if (!bson_iter_init(&iter, doc) || !bson_iter_find_descendant(&iter, "attributes.trade_id", &descent)) {
+        return -1;
+    }
+    if (!bson_iter_init_find(&iter, doc, "_time")) {
+        return -1;
+    }
+    if (!bson_iter_init(&iter, doc) || !bson_iter_find_descendant(&iter, "attributes.level", &descent)) {
+        return -1;
+    }
+    const char *level = bson_iter_utf8(&descent, NULL);
+    return (strcmp(level, "info") == 0 || strcmp(level, "error") == 0 || strcmp(level, "warn") == 0) ? 0 : -1;
+}
+
+static void stamp_doc(bson_t *doc) {
+    bson_t *attributes = bson_new();
+    BCON_APPEND(attributes, "region_id", BCON_UTF8("US"), "semconv_version", BCON_UTF8("1.32"));
+    BCON_APPEND(doc, "attributes", BCON_DOCUMENT(attributes), "_time", BCON_DATE_TIME(1697059200000));
+    bson_destroy(attributes);
+}
+
+// Approximate percentile from the power-of-two histogram of a perf site:
+// returns the upper bound of the bucket the percentile falls in.
+static uint64_t site_percentile_ns(int site, double percentile) {
+    uint64_t total = 0;
+    for (int bucket = 0; bucket < PERF_BUCKETS; bucket++) {
+        total += perf_sites[site].buckets[bucket];
+    }
+    uint64_t target = (uint64_t)(total * percentile);
+    uint64_t cumulative = 0;
+    uint64_t bound = 1;
+    for (int bucket = 0; bucket < PERF_BUCKETS; bucket++) {
+        cumulative += perf_sites[site].buckets[bucket];
+        if (cumulative >= target) {
+            return bound;
+        }
+        bound <<= 1;
+    }
+    return bound;
+}
+
+static void report(const char *name, int site, uint64_t wall_ns, uint64_t allocs) {
+    double seconds = wall_ns / 1e9;
+    printf("%-24s %10.0f traces/sec  %6.1f allocs/op  p50 <= %lluns  p99 <= %lluns\n",
+           name, BENCH_TRACES / seconds, (double)allocs / BENCH_TRACES,
+           (unsigned long long)site_percentile_ns(site, 0.50),
+           (unsigned long long)site_percentile_ns(site, 0.99));
+}
+
+int main() {
+    bson_mem_set_vtable(&(bson_mem_vtable_t){bench_malloc, bench_calloc, bench_realloc, bench_free, {NULL}});
+
+    char **traces = (char**)malloc(BENCH_TRACES * sizeof(char*));
+    for (int i = 0; i < BENCH_TRACES; i++) {
+        traces[i] = make_trace_json(i);
+    }
+    printf("Benchmarking %d synthetic traces (%d attributes each)\n\n", BENCH_TRACES, BENCH_ATTRIBUTES);
+
+    // 1. JSON entry point: parse + validate, the cost validate_requirements pays.
+    int parse_site = perf_register("bench_parse_validate");
+    bench_allocs = 0;
+    uint64_t wall_start = perf_now_ns();
+    for (int i = 0; i < BENCH_TRACES; i++) {
+        uint64_t start = perf_now_ns();
+        bson_t *doc = bson_new_from_json((const uint8_t *)traces[i], -1, NULL);
+        validate_doc(doc);
+        bson_destroy(doc);
+        perf_record(parse_site, start);
+    }
+    report("parse + validate", parse_site, perf_now_ns() - wall_start, bench_allocs);
+
+    // 2. Zero-copy path: validation alone over pre-parsed documents, the cost
+    // validate_requirements_bson pays on the dispatcher's wire batch.
+    bson_t **docs = (bson_t**)malloc(BENCH_TRACES * sizeof(bson_t*));
+    for (int i = 0; i < BENCH_TRACES; i++) {
+        docs[i] = bson_new_from_json((const uint8_t *)traces[i], -1, NULL);
+    }
+    int validate_site = perf_register("bench_validate_bson");
+    bench_allocs = 0;
+    wall_start = perf_now_ns();
+    for (int i = 0; i < BENCH_TRACES; i++) {
+        uint64_t start = perf_now_ns();
+        validate_doc(docs[i]);
+        perf_record(validate_site, start);
+    }
+    report("validate (zero-copy)", validate_site, perf_now_ns() - wall_start, bench_allocs);
+
+    // 3. Full dispatch build: parse, stamp, mock insert - dispatch_trace minus Mongo.
+    int build_site = perf_register("bench_build_dispatch");
+    bench_allocs = 0;
+    wall_start = perf_now_ns();
+    for (int i = 0; i < BENCH_TRACES; i++) {
+        uint64_t start = perf_now_ns();
+        bson_t *doc = bson_new_from_json((const uint8_t *)traces[i], -1, NULL);
+        stamp_doc(doc);
+        mock_insert(doc);
+        bson_destroy(doc);
+        perf_record(build_site, start);
+    }
+    report("build + dispatch (mock)", build_site, perf_now_ns() - wall_start, bench_allocs);
+
+    printf("\nMock collection received %zu bytes\n", mock_collection_bytes);
+    perf_dump_to_file("benchmark_metrics.prom");
+
+    for (int i = 0; i < BENCH_TRACES; i++) {
+        bson_destroy(docs[i]);
+        free(traces[i]);
+    }
+    free(docs);
+    free(traces);
+    return 0;
+}
@@ -4,82 +4,436 @@
 #include <map>
 #include <mutex>
 #include <thread>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <deque>
+#include <memory>
 #include <mongocxx/client.hpp>
 #include <mongocxx/instance.hpp>
 #include <mongocxx/uri.hpp>
 #include <mongocxx/collection.hpp>
+#include <mongocxx/options/aggregate.hpp>
+#include <mongocxx/options/update.hpp>
 #include <bsoncxx/builder/stream/document.hpp>
 #include <bsoncxx/json.hpp>
 
+#include "../../perf_metrics.h"
+#include "../../field_columns.h"
+
 using bsoncxx::builder::stream::document;
 using bsoncxx::builder::stream::finalize;
 
 class PitfallFixManager {
 private:
+    struct FieldProfile {
+        std::vector<std::string> types;
+        long long count = 0;
+    };
+
+    std::string mongo_uri;
     mongocxx::client client;
     mongocxx::database db;
     mongocxx::collection collection;
+    mongocxx::collection checkpoints;
     std::mutex mutex;
     int max_fields = 100;
     int time_gap_threshold = 3600; // seconds
+    int cursor_batch_size = 1000;
+    bool incremental = false;
+    int fix_range_size = 500000;
+    int gap_log_sample = 1000;
+    std::map<std::string, FieldProfile> field_profile;
+    bool profile_loaded = false;
+    long long gaps_fixed = 0;
 
-public:
-    PitfallFixManager(const std::string& mongo_uri) : client(mongocxx::uri(mongo_uri)), db(client["zero0x_db"]), collection(db["trades_dataset"]) {
-        std::cout << "Manager initialized" << std::endl;
+    bsoncxx::types::b_date load_watermark(const std::string& fix_name) {
+        auto doc = checkpoints.find_one((document{} << "_id" << fix_name << finalize).view());
+        if (doc) {
+            return doc->view()["watermark"].get_date();
+        }
+        return bsoncxx::types::b_date(std::chrono::milliseconds(0));
     }
 
-    void fix_mixed_data() {
-        // Simulate fixing mixed types
-        auto pipeline = document{} << "$project" << document{} << "fields" << document{} << "$objectToArray" << "$$ROOT" << finalize
-                                   << "$unwind" << "$fields"
-                                   << "$group" << document{} << "_id" << "$fields.k" << "types" << document{} << "$addToSet" << document{} << "$type" << "$fields.v" << finalize << finalize
-                                   << finalize;
-        auto cursor = collection.aggregate(pipeline.view());
+    void save_watermark(const std::string& fix_name, bsoncxx::types::b_date watermark) {
+        mongocxx::options::update opts{};
+        opts.upsert(true);
+        checkpoints.update_one((document{} << "_id" << fix_name << finalize).view(),
+                               (document{} << "$set" << document{} << "watermark" << watermark << finalize << finalize).view(),
+                               opts);
+    }
+
+    // Caller must hold mutex.
+    void merge_profile_entry(const bsoncxx::document::view& doc) {
+        auto& profile = field_profile[doc["_id"].get_utf8().value.to_string()];
+        for (auto&& type : doc["types"].get_array().value) {
+            auto type_name = type.get_utf8().value.to_string();
+            if (std::find(profile.types.begin(), profile.types.end(), type_name) == profile.types.end()) {
+                profile.types.push_back(type_name);
+            }
+        }
+        profile.count += doc["count"].get_int64();
+    }
+
+    // Caller must hold mutex. Expands the columnar sidecar's type bitmaps
+    // into the same shape merge_profile_entry builds from the aggregation,
+    // so every downstream fix consumes the profile unchanged.
+    bool load_profile_from_columns() {
+        if (field_columns_load(FIELD_COLUMNS_FILE) <= 0) {
+            return false;
+        }
+        for (int i = 0; i < FIELD_COLUMNS_MAX; i++) {
+            const FieldColumn& column = field_columns[i];
+            if (!column.used) {
+                continue;
+            }
+            auto& profile = field_profile[column.name];
+            for (int bit = 0; bit < FIELD_TYPE_BITS; bit++) {
+                if (column.type_bitmap & (1u << bit)) {
+                    profile.types.push_back(field_columns_type_name(1u << bit));
+                }
+            }
+            profile.count += (long long)column.count;
+        }
+        return true;
+    }
+
+    // Samples every range_size-th _id (covered by the _id index, so only keys
+    // come over the wire) to shard the fixes into independent range tasks.
+    std::vector<bsoncxx::oid> collect_range_boundaries() {
+        mongocxx::options::find opts{};
+        opts.sort((document{} << "_id" << 1 << finalize).view());
+        opts.projection((document{} << "_id" << 1 << finalize).view());
+
+        std::vector<bsoncxx::oid> boundaries;
+        int position = 0;
+        auto cursor = collection.find({}, opts);
         for (auto&& doc : cursor) {
-            auto types = doc["types"].get_array().value;
-            if (types.length() > 1) {
-                std::cout << "Fixing mixed type in field: " << doc["_id"].get_utf8().value.to_string() << std::endl;
+            if (position % fix_range_size == 0) {
+                boundaries.push_back(doc["_id"].get_oid().value);
             }
+            position++;
         }
+        return boundaries;
     }
 
-    void fix_large_time_gaps() {
-        auto filter = document{} << "gap" << document{} << "$gt" << time_gap_threshold * 1000 << finalize;
-        auto project = document{} << "$project" << document{} << "gap" << document{} << "$subtract" << bsoncxx::builder::stream::open_array << "$_sysTime" << "$_time" << bsoncxx::builder::stream::close_array << finalize << finalize;
-        auto cursor = collection.aggregate({project.view(), { "$match", filter.view() }});
-        int count = 0;
+    bsoncxx::builder::stream::document build_range_match(bsoncxx::oid min_id, bsoncxx::oid max_id, bool has_max_id, bsoncxx::types::b_date watermark) {
+        bsoncxx::builder::stream::document match{};
+        match << "_id" << bsoncxx::builder::stream::open_document << "$gte" << min_id;
+        if (has_max_id) {
+            match << "$lt" << max_id;
+        }
+        match << bsoncxx::builder::stream::close_document;
+        if (incremental) {
+            match << "_sysTime" << document{} << "$gt" << watermark << finalize;
+        }
+        return match;
+    }
+
+    // Range tasks run on the worker threads, so they aggregate through the
+    // worker's own collection (mongocxx::client is not thread-safe) rather
+    // than the shared member.
+    void profile_range(mongocxx::collection& coll, bsoncxx::oid min_id, bsoncxx::oid max_id, bool has_max_id, bsoncxx::types::b_date watermark) {
+        static int perf_site = perf_register("profile_range");
+        uint64_t perf_start = perf_now_ns();
+
+        auto match = build_range_match(min_id, max_id, has_max_id, watermark);
+        bsoncxx::builder::stream::document pipeline{};
+        pipeline << "$match" << match
+                 << "$project" << document{} << "fields" << document{} << "$objectToArray" << "$$ROOT" << finalize << finalize
+                 << "$unwind" << "$fields"
+                 << "$group" << document{} << "_id" << "$fields.k"
+                             << "types" << document{} << "$addToSet" << document{} << "$type" << "$fields.v" << finalize << finalize
+                             << "count" << document{} << "$sum" << 1 << finalize << finalize;
+        mongocxx::options::aggregate agg_opts{};
+        agg_opts.batch_size(cursor_batch_size);
+        auto cursor = coll.aggregate((pipeline << finalize).view(), agg_opts);
         for (auto&& doc : cursor) {
+            std::lock_guard<std::mutex> lock(mutex);
+            merge_profile_entry(doc);
+        }
+        perf_record(perf_site, perf_start);
+    }
+
+    void gaps_range(mongocxx::collection& coll, bsoncxx::oid min_id, bsoncxx::oid max_id, bool has_max_id, bsoncxx::types::b_date watermark) {
+        static int perf_site = perf_register("gaps_range");
+        uint64_t perf_start = perf_now_ns();
+
+        auto match = build_range_match(min_id, max_id, has_max_id, watermark);
+        bsoncxx::builder::stream::document pipeline{};
+        pipeline << "$match" << match
+                 << "$project" << document{} << "gap" << document{} << "$subtract" << bsoncxx::builder::stream::open_array << "$_sysTime" << "$_time" << bsoncxx::builder::stream::close_array << finalize << finalize
+                 << "$match" << document{} << "gap" << document{} << "$gt" << time_gap_threshold * 1000 << finalize << finalize;
+        mongocxx::options::aggregate agg_opts{};
+        agg_opts.batch_size(cursor_batch_size);
+        auto cursor = coll.aggregate((pipeline << finalize).view(), agg_opts);
+        long long count = 0;
+        for (auto&& doc : cursor) {
+            // Counter with sampled logging: serializing every hit with to_json
+            // made the drain CPU-bound on one core.
+            if (count % gap_log_sample == 0) {
+                std::cout << "Fixing time gap in document: " << doc["_id"].get_oid().value.to_string() << std::endl;
+            }
             count++;
-            std::cout << "Fixing time gap in document: " << bsoncxx::to_json(doc) << std::endl;
         }
-        std::cout << "Fixed " << count << " time gaps" << std::endl;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            gaps_fixed += count;
+        }
+        perf_record(perf_site, perf_start);
     }
 
-    void fix_excessive_fields() {
-        auto pipeline = document{} << "$project" << document{} << "fields" << document{} << "$objectToArray" << "$$ROOT" << finalize << finalize
-                                   << "$unwind" << "$fields"
-                                   << "$group" << document{} << "_id" << "$fields.k" << finalize << finalize;
-        auto cursor = collection.aggregate(pipeline.view());
-        std::vector<std::string> fields;
+    // One _time window of the parallel gap drain. Aggregates on the window
+    // worker's own collection, same rule as the range tasks above.
+    void gaps_time_range(mongocxx::collection& coll, int64_t window_start_ms, int64_t window_end_ms, bsoncxx::types::b_date watermark) {
+        bsoncxx::builder::stream::document match{};
+        match << "_time" << bsoncxx::builder::stream::open_document
+              << "$gte" << bsoncxx::types::b_date(std::chrono::milliseconds(window_start_ms))
+              << "$lt" << bsoncxx::types::b_date(std::chrono::milliseconds(window_end_ms))
+              << bsoncxx::builder::stream::close_document;
+        if (incremental) {
+            match << "_sysTime" << document{} << "$gt" << watermark << finalize;
+        }
+
+        bsoncxx::builder::stream::document pipeline{};
+        pipeline << "$match" << match
+                 << "$project" << document{} << "gap" << document{} << "$subtract" << bsoncxx::builder::stream::open_array << "$_sysTime" << "$_time" << bsoncxx::builder::stream::close_array << finalize << finalize
+                 << "$match" << document{} << "gap" << document{} << "$gt" << time_gap_threshold * 1000 << finalize << finalize;
+
+        mongocxx::options::aggregate agg_opts{};
+        agg_opts.batch_size(cursor_batch_size);
+        auto cursor = coll.aggregate((pipeline << finalize).view(), agg_opts);
+        long long count = 0;
         for (auto&& doc : cursor) {
-            fields.push_back(doc["_id"].get_utf8().value.to_string());
+            if (count % gap_log_sample == 0) {
+                std::cout << "Fixing time gap in document: " << doc["_id"].get_oid().value.to_string() << std::endl;
+            }
+            count++;
         }
-        if (fields.size() > static_cast<size_t>(max_fields)) {
-            std::cout << "Trimming excessive fields: " << fields.size() - max_fields << std::endl;
+        std::lock_guard<std::mutex> lock(mutex);
+        gaps_fixed += count;
+    }
+
+public:
+    PitfallFixManager(const std::string& mongo_uri) : mongo_uri(mongo_uri), client(mongocxx::uri(mongo_uri)), db(client["zero0x_db"]), collection(db["trades_dataset"]), checkpoints(db["pitfall_checkpoints"]) {
+        std::cout << "Manager initialized" << std::endl;
+    }
+
+    // Incremental mode only aggregates documents whose _sysTime is newer than
+    // the per-fix watermark persisted in pitfall_checkpoints, so the 15-minute
+    // cron run scans the delta since the last run instead of the full dataset.
+    void enable_incremental() {
+        incremental = true;
+    }
+
+    // One scan of trades_dataset producing per-field type sets and counts.
+    // Both fix_mixed_data() and fix_excessive_fields() consume this profile,
+    // so the collection is aggregated once per run instead of once per fix.
+    const std::map<std::string, FieldProfile>& collect_field_profile() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (profile_loaded) {
+            return field_profile;
+        }
+
+        // Columnar fast path: the dispatcher maintains a per-field type
+        // bitmap + count sidecar at ingest; when it exists, profiling is a
+        // sequential read of that file instead of a $objectToArray + $unwind
+        // aggregation over every raw document.
+        if (load_profile_from_columns()) {
+            std::cout << "Field profile loaded from columnar sidecar (" << field_profile.size() << " fields)" << std::endl;
+            profile_loaded = true;
+            return field_profile;
+        }
+
+        auto scan_start = bsoncxx::types::b_date(std::chrono::system_clock::now());
+        bsoncxx::builder::stream::document pipeline{};
+        if (incremental) {
+            pipeline << "$match" << document{} << "_sysTime" << document{} << "$gt" << load_watermark("field_profile") << finalize << finalize;
+        }
+        pipeline << "$project" << document{} << "fields" << document{} << "$objectToArray" << "$$ROOT" << finalize << finalize
+                 << "$unwind" << "$fields"
+                 << "$group" << document{} << "_id" << "$fields.k"
+                             << "types" << document{} << "$addToSet" << document{} << "$type" << "$fields.v" << finalize << finalize
+                             << "count" << document{} << "$sum" << 1 << finalize << finalize;
+
+        mongocxx::options::aggregate agg_opts{};
+        agg_opts.batch_size(cursor_batch_size);
+        auto cursor = collection.aggregate((pipeline << finalize).view(), agg_opts);
+        for (auto&& doc : cursor) {
+            merge_profile_entry(doc);
+        }
+        if (incremental) {
+            save_watermark("field_profile", scan_start);
+        }
+        profile_loaded = true;
+        return field_profile;
+    }
+
+    void fix_mixed_data() {
+        for (auto& entry : collect_field_profile()) {
+            if (entry.second.types.size() > 1) {
+                std::cout << "Fixing mixed type in field: " << entry.first << std::endl;
+            }
+        }
+    }
+
+    // Splits the drain into N _time windows executed in parallel, each with
+    // its own prefetching cursor, instead of one thread spinning on a single
+    // cursor and a to_json per hit.
+    void fix_large_time_gaps() {
+        auto scan_start = bsoncxx::types::b_date(std::chrono::system_clock::now());
+        auto watermark = load_watermark("time_gaps");
+        gaps_fixed = 0;
+
+        mongocxx::options::find bound_opts{};
+        bound_opts.projection((document{} << "_time" << 1 << finalize).view());
+        bound_opts.sort((document{} << "_time" << 1 << finalize).view());
+        auto oldest = collection.find_one({}, bound_opts);
+        bound_opts.sort((document{} << "_time" << -1 << finalize).view());
+        auto newest = collection.find_one({}, bound_opts);
+        if (!oldest || !newest) {
+            std::cout << "Fixed 0 time gaps" << std::endl;
+            return;
+        }
+        int64_t min_time = oldest->view()["_time"].get_date().to_int64();
+        int64_t max_time = newest->view()["_time"].get_date().to_int64() + 1;
+
+        size_t worker_count = std::max<size_t>(1, std::thread::hardware_concurrency());
+        int64_t window_ms = std::max<int64_t>(1, (max_time - min_time + (int64_t)worker_count - 1) / (int64_t)worker_count);
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < worker_count; i++) {
+            int64_t window_start_ms = min_time + (int64_t)i * window_ms;
+            int64_t window_end_ms = std::min(max_time, window_start_ms + window_ms);
+            if (window_start_ms >= max_time) {
+                break;
+            }
+            workers.emplace_back([this, window_start_ms, window_end_ms, watermark]() {
+                mongocxx::client worker_client{mongocxx::uri(mongo_uri)};
+                auto worker_collection = worker_client["zero0x_db"]["trades_dataset"];
+                gaps_time_range(worker_collection, window_start_ms, window_end_ms, watermark);
+            });
         }
+        for (auto& th : workers) {
+            th.join();
+        }
+
+        if (incremental) {
+            save_watermark("time_gaps", scan_start);
+        }
+        std::cout << "Fixed " << gaps_fixed << " time gaps" << std::endl;
     }
 
+    void fix_excessive_fields() {
+        auto& profile = collect_field_profile();
+        if (profile.size() > static_cast<size_t>(max_fields)) {
+            std::cout << "Trimming excessive fields: " << profile.size() - max_fields << std::endl;
+        }
+    }
+
+    // Work-stealing scheduler: each fix is expressed as a generator of
+    // independent _id-range tasks, seeded round-robin onto per-worker deques.
+    // Workers pop from the back of their own deque and steal from the front
+    // of others, so all cores stay busy instead of one thread per fix.
     void run_fixes() {
-        std::vector<std::thread> threads;
-        threads.emplace_back(&PitfallFixManager::fix_mixed_data, this);
-        threads.emplace_back(&PitfallFixManager::fix_large_time_gaps, this);
-        threads.emplace_back(&PitfallFixManager::fix_excessive_fields, this);
-        for (auto& th : threads) {
+        auto scan_start = bsoncxx::types::b_date(std::chrono::system_clock::now());
+        auto profile_watermark = load_watermark("field_profile");
+        auto gaps_watermark = load_watermark("time_gaps");
+        gaps_fixed = 0;
+
+        // Tasks take the executing worker's collection: each worker owns a
+        // dedicated client (mongocxx::client is not thread-safe, same pattern
+        // as the migrate_batch workers).
+        auto boundaries = collect_range_boundaries();
+        std::vector<std::function<void(mongocxx::collection&)>> tasks;
+        auto add_range_tasks = [&](std::function<void(mongocxx::collection&, bsoncxx::oid, bsoncxx::oid, bool)> fix_range) {
+            for (size_t i = 0; i + 1 < boundaries.size(); i++) {
+                auto min_id = boundaries[i];
+                auto max_id = boundaries[i + 1];
+                tasks.push_back([fix_range, min_id, max_id](mongocxx::collection& coll) { fix_range(coll, min_id, max_id, true); });
+            }
+            if (!boundaries.empty()) {
+                auto min_id = boundaries.back();
+                tasks.push_back([fix_range, min_id](mongocxx::collection& coll) { fix_range(coll, min_id, min_id, false); });
+            }
+        };
+        // Profiling ranges are only scheduled when no columnar sidecar
+        // exists; with one on disk the profile is a sequential file read and
+        // the aggregation tasks would be pure waste.
+        bool profile_from_columns;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            profile_from_columns = load_profile_from_columns();
+        }
+        if (!profile_from_columns) {
+            add_range_tasks([this, profile_watermark](mongocxx::collection& coll, bsoncxx::oid min_id, bsoncxx::oid max_id, bool has_max_id) {
+                profile_range(coll, min_id, max_id, has_max_id, profile_watermark);
+            });
+        }
+        add_range_tasks([this, gaps_watermark](mongocxx::collection& coll, bsoncxx::oid min_id, bsoncxx::oid max_id, bool has_max_id) {
+            gaps_range(coll, min_id, max_id, has_max_id, gaps_watermark);
+        });
+
+        size_t worker_count = std::max<size_t>(1, std::thread::hardware_concurrency());
+        std::vector<std::deque<std::function<void(mongocxx::collection&)>>> queues(worker_count);
+        std::vector<std::unique_ptr<std::mutex>> queue_mutexes;
+        for (size_t i = 0; i < worker_count; i++) {
+            queue_mutexes.emplace_back(new std::mutex());
+        }
+        for (size_t i = 0; i < tasks.size(); i++) {
+            queues[i % worker_count].push_back(std::move(tasks[i]));
+        }
+
+        std::vector<std::thread> workers;
+        for (size_t self = 0; self < worker_count; self++) {
+            workers.emplace_back([&, self]() {
+                mongocxx::client worker_client{mongocxx::uri(mongo_uri)};
+                auto worker_collection = worker_client["zero0x_db"]["trades_dataset"];
+                for (;;) {
+                    std::function<void(mongocxx::collection&)> task;
+                    {
+                        std::lock_guard<std::mutex> lock(*queue_mutexes[self]);
+                        if (!queues[self].empty()) {
+                            task = std::move(queues[self].back());
+                            queues[self].pop_back();
+                        }
+                    }
+                    for (size_t victim = 0; !task && victim < worker_count; victim++) {
+                        if (victim == self) {
+                            continue;
+                        }
+                        std::lock_guard<std::mutex> lock(*queue_mutexes[victim]);
+                        if (!queues[victim].empty()) {
+                            task = std::move(queues[victim].front());
+                            queues[victim].pop_front();
+                        }
+                    }
+                    if (!task) {
+                        break;
+                    }
+                    task(worker_collection);
+                }
+            });
+        }
+        for (auto& th : workers) {
             th.join();
         }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            profile_loaded = true;
+        }
+        if (incremental) {
+            save_watermark("field_profile", scan_start);
+            save_watermark("time_gaps", scan_start);
+        }
+        std::cout << "Fixed " << gaps_fixed << " time gaps" << std::endl;
+
+        fix_mixed_data();
+        fix_excessive_fields();
     }
 
     ~PitfallFixManager() {
+        perf_dump_to_file("fixer_metrics.prom");
         std::cout << "Manager shutdown" << std::endl;
     }
 };
@@ -87,6 +441,7 @@ public:
 int main() {
     mongocxx::instance inst{};
     PitfallFixManager manager("mongodb://localhost:27017");
+    manager.enable_incremental();
     manager.run_fixes();
     return 0;
 }
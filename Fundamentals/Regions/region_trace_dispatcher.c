@@ -1,33 +1,296 @@
 #include <mongoc/mongoc.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
+
+#include "trace_ring_buffer.h"
+#include "../../perf_metrics.h"
+#include "../../binlog.h"
+#include "../../schema_cache.h"
+#include "../../field_columns.h"
 
 #define MONGO_URI "mongodb://localhost:27017"
+#define METRICS_FILE "dispatcher_metrics.prom"
 #define DB_NAME "zero0x_db"
 #define COLLECTION_NAME "traces"
-#define MAX_REGIONS 2
+#define REGION_CAPACITY 16
+#define REGION_HASH_SIZE 64
+#define BATCH_CAPACITY 500
+#define BATCH_MAX_AGE_MS 200
+#define ARENA_DEFAULT_BYTES (4 * 1024 * 1024)
+#define ARENA_ALIGNMENT 16
+#define RETRY_QUEUE_CAPACITY 1024
+#define RETRY_BASE_DELAY_MS 100
+#define RETRY_MAX_DELAY_MS 30000
+#define REPLICATION_QUEUE_CAPACITY 2048
+#define REPLICATION_BATCH 100
+#define ADMISSION_RATE_PER_CONN 200.0 /* traces/sec each pooled connection absorbs */
+#define ADMISSION_BURST_SECONDS 2.0
+
+typedef struct {
+    bson_t *docs[BATCH_CAPACITY];
+    size_t count;
+    int64_t oldest_ms;
+    // Guards docs/count/oldest_ms: ingest runs from multiple threads per
+    // region, and the flusher thread reads ages concurrently.
+    pthread_mutex_t mutex;
+} TraceBatch;
 
 typedef struct {
     const char *region_id;
     const char *endpoint;
     int max_retries;
+    int pool_size;
+    mongoc_client_pool_t *pool;
+    TraceBatch batch;
+    // Admission gate: refill-on-demand token bucket sized from the region's
+    // pool, plus shed/admit counters for the metrics dump. All of it is
+    // guarded by the batch mutex above, since ingest runs from multiple
+    // threads per region.
+    double admission_rate;
+    double admission_burst;
+    double admission_tokens;
+    int64_t admission_refill_ms;
+    uint64_t admitted;
+    uint64_t shed;
 } RegionConfig;
 
+typedef struct {
+    bson_t *doc;
+    int region_idx;
+    int attempts;
+    int64_t next_attempt_ms;
+} RetryEntry;
+
+typedef struct {
+    RetryEntry entries[RETRY_QUEUE_CAPACITY];
+    size_t head;
+    size_t tail;
+    size_t count;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_t worker;
+    int shutdown;
+} RetryQueue;
+
+typedef struct {
+    bson_t *doc;
+    int region_idx;
+} ReplicationEntry;
+
+// Async hand-off for the remote-region copy of cross-region traces. Bounded:
+// producers block on not_full when replication falls behind (backpressure)
+// instead of growing memory without limit.
+typedef struct {
+    ReplicationEntry entries[REPLICATION_QUEUE_CAPACITY];
+    size_t head;
+    size_t tail;
+    size_t count;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    pthread_t worker;
+    int shutdown;
+} ReplicationQueue;
+
 typedef struct {
     mongoc_client_t *client;
     mongoc_collection_t *collection;
-    RegionConfig regions[MAX_REGIONS];
+    RegionConfig regions[REGION_CAPACITY];
+    int region_count;
+    // Open-addressed index over region_id: slots hold region index + 1, 0 is
+    // empty. Region ids are interned to a slot once at registration, so the
+    // per-trace lookup is O(1) instead of a strcmp scan.
+    int region_hash[REGION_HASH_SIZE];
+    RetryQueue retry_queue;
+    ReplicationQueue replication_queue;
+    pthread_t flusher;
+    int flusher_shutdown;
+    TraceRing ring;
+    int ring_ready;
     FILE *log_file;
 } TraceDispatcher;
 
+static void* retry_worker(void *arg);
+static void* replication_worker(void *arg);
+static void* batch_flusher(void *arg);
+
 void log_message(TraceDispatcher *dispatcher, const char *level, const char *msg) {
+    // Hot-path logging goes through the binary ring; the flushed fprintf is
+    // only the fallback before binlog_init or after shutdown.
+    if (binlog_ready()) {
+        binlog_write(binlog_level_from_string(level), msg);
+        return;
+    }
     time_t now = time(NULL);
     fprintf(dispatcher->log_file, "[%s] %s: %s\n", ctime(&now), level, msg);
     fflush(dispatcher->log_file);
 }
 
+// Bump arena backing per-trace BSON buffers. Trace documents live exactly one
+// batch, so the arena is reset wholesale once no batch holds them instead of
+// paying malloc/free per bson_t. The vtable is process-wide, so the gate is
+// thread-local: only the ingest thread that is currently building a trace
+// document allocates from the arena, and allocations made concurrently by
+// the retry/replication/flusher threads always fall through to the system
+// allocator. The bump itself is a CAS so several ingest threads can build
+// documents at once. arena_gate packs the builders-in-flight count (low
+// bits) and a reset-in-progress bit into one word, so builder entry and the
+// wholesale reset are mutually exclusive: a reset only starts when the count
+// is zero, and no builder can slip in between that check and the rewind.
+typedef struct {
+    uint8_t *base;
+    size_t capacity;
+    size_t used;
+} TraceArena;
+
+#define ARENA_RESET_BIT 0x80000000u
+
+static TraceArena trace_arena = {NULL, 0, 0};
+static _Thread_local int arena_active = 0;
+static uint32_t arena_gate = 0;
+
+// A builder holds the arena open from the first allocation of its document
+// until the document is safely owned by a batch (or destroyed): enter before
+// parsing, pause once construction is done (so flush-path allocations do not
+// land in the arena), exit after the enqueue or final destroy. Entry spins
+// out any in-flight reset, which is only a store of used = 0.
+static void arena_builder_enter(void) {
+    uint32_t gate = __atomic_load_n(&arena_gate, __ATOMIC_RELAXED);
+    do {
+        while (gate & ARENA_RESET_BIT) {
+            gate = __atomic_load_n(&arena_gate, __ATOMIC_RELAXED);
+        }
+    } while (!__atomic_compare_exchange_n(&arena_gate, &gate, gate + 1, 1,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+    arena_active = 1;
+}
+
+static void arena_builder_pause(void) {
+    arena_active = 0;
+}
+
+static void arena_builder_exit(void) {
+    arena_active = 0;
+    __atomic_fetch_sub(&arena_gate, 1, __ATOMIC_ACQ_REL);
+}
+
+static int arena_owns(const void *ptr) {
+    return trace_arena.base && (const uint8_t *)ptr >= trace_arena.base &&
+           (const uint8_t *)ptr < trace_arena.base + trace_arena.capacity;
+}
+
+static void* arena_malloc(size_t num_bytes) {
+    size_t padded = (num_bytes + ARENA_ALIGNMENT + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    if (!arena_active || !trace_arena.base) {
+        return malloc(num_bytes);
+    }
+    size_t used = __atomic_load_n(&trace_arena.used, __ATOMIC_RELAXED);
+    do {
+        if (used + padded > trace_arena.capacity) {
+            return malloc(num_bytes);
+        }
+    } while (!__atomic_compare_exchange_n(&trace_arena.used, &used, used + padded, 1,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    uint8_t *block = trace_arena.base + used;
+    *(size_t *)block = num_bytes;
+    return block + ARENA_ALIGNMENT;
+}
+
+static void* arena_calloc(size_t n_members, size_t num_bytes) {
+    void *mem = arena_malloc(n_members * num_bytes);
+    if (mem) {
+        memset(mem, 0, n_members * num_bytes);
+    }
+    return mem;
+}
+
+static void* arena_realloc(void *mem, size_t num_bytes) {
+    if (!mem) {
+        return arena_malloc(num_bytes);
+    }
+    if (!arena_owns(mem)) {
+        return realloc(mem, num_bytes);
+    }
+    size_t old_bytes = *(size_t *)((uint8_t *)mem - ARENA_ALIGNMENT);
+    if (num_bytes <= old_bytes) {
+        return mem;
+    }
+    void *fresh = arena_malloc(num_bytes);
+    if (fresh) {
+        memcpy(fresh, mem, old_bytes);
+    }
+    return fresh;
+}
+
+static void arena_free(void *mem) {
+    if (mem && !arena_owns(mem)) {
+        free(mem);
+    }
+}
+
+static void arena_reset() {
+    __atomic_store_n(&trace_arena.used, 0, __ATOMIC_RELEASE);
+}
+
+static uint32_t region_hash_key(const char *region_id) {
+    uint32_t hash = 2166136261u;
+    for (const char *c = region_id; *c; c++) {
+        hash = (hash ^ (uint32_t)*c) * 16777619u;
+    }
+    return hash;
+}
+
+// Registers a region endpoint with its own client pool and insert batch.
+// Returns the region index, or -1 when the registry or its pool is exhausted.
+int register_region(TraceDispatcher *dispatcher, const char *region_id, const char *endpoint, int max_retries, int pool_size) {
+    if (dispatcher->region_count >= REGION_CAPACITY) {
+        log_message(dispatcher, "ERROR", "Region registry full");
+        return -1;
+    }
+
+    char uri_str[256];
+    snprintf(uri_str, sizeof(uri_str), "mongodb://%s:27017", endpoint);
+    mongoc_uri_t *uri = mongoc_uri_new(uri_str);
+    if (!uri) {
+        log_message(dispatcher, "ERROR", "Invalid region URI");
+        return -1;
+    }
+
+    int idx = dispatcher->region_count++;
+    RegionConfig *region = &dispatcher->regions[idx];
+    region->region_id = region_id;
+    region->endpoint = endpoint;
+    region->max_retries = max_retries;
+    region->pool_size = pool_size;
+    region->pool = mongoc_client_pool_new(uri);
+    mongoc_client_pool_max_size_set(region->pool, pool_size);
+    mongoc_uri_destroy(uri);
+    region->batch.count = 0;
+    region->batch.oldest_ms = 0;
+    pthread_mutex_init(&region->batch.mutex, NULL);
+    region->admission_rate = pool_size * ADMISSION_RATE_PER_CONN;
+    region->admission_burst = region->admission_rate * ADMISSION_BURST_SECONDS;
+    region->admission_tokens = region->admission_burst;
+    region->admission_refill_ms = 0;
+    region->admitted = 0;
+    region->shed = 0;
+
+    uint32_t slot = region_hash_key(region_id) % REGION_HASH_SIZE;
+    while (dispatcher->region_hash[slot] != 0) {
+        slot = (slot + 1) % REGION_HASH_SIZE;
+    }
+    dispatcher->region_hash[slot] = idx + 1;
+
+    char msg[256];
+    snprintf(msg, sizeof(msg), "Region %s registered (%s)", region_id, endpoint);
+    log_message(dispatcher, "INFO", msg);
+    return idx;
+}
+
 TraceDispatcher* init_dispatcher() {
     TraceDispatcher *dispatcher = (TraceDispatcher*)malloc(sizeof(TraceDispatcher));
     if (!dispatcher) {
@@ -40,6 +303,7 @@ TraceDispatcher* init_dispatcher() {
         free(dispatcher);
         return NULL;
     }
+    binlog_init("dispatcher.binlog");
 
     mongoc_init();
     dispatcher->client = mongoc_client_new(MONGO_URI);
@@ -52,8 +316,39 @@ TraceDispatcher* init_dispatcher() {
     }
 
     dispatcher->collection = mongoc_client_get_collection(dispatcher->client, DB_NAME, COLLECTION_NAME);
-    dispatcher->regions[0] = (RegionConfig){"US", "us.zero0x.trade", 3};
-    dispatcher->regions[1] = (RegionConfig){"EU", "eu.zero0x.trade", 3};
+    dispatcher->region_count = 0;
+    memset(dispatcher->region_hash, 0, sizeof(dispatcher->region_hash));
+    register_region(dispatcher, "US", "us.zero0x.trade", 3, 16);
+    register_region(dispatcher, "EU", "eu.zero0x.trade", 3, 8);
+
+    dispatcher->retry_queue.head = 0;
+    dispatcher->retry_queue.tail = 0;
+    dispatcher->retry_queue.count = 0;
+    dispatcher->retry_queue.shutdown = 0;
+    pthread_mutex_init(&dispatcher->retry_queue.mutex, NULL);
+    pthread_cond_init(&dispatcher->retry_queue.not_empty, NULL);
+    pthread_create(&dispatcher->retry_queue.worker, NULL, retry_worker, dispatcher);
+
+    dispatcher->replication_queue.head = 0;
+    dispatcher->replication_queue.tail = 0;
+    dispatcher->replication_queue.count = 0;
+    dispatcher->replication_queue.shutdown = 0;
+    pthread_mutex_init(&dispatcher->replication_queue.mutex, NULL);
+    pthread_cond_init(&dispatcher->replication_queue.not_empty, NULL);
+    pthread_cond_init(&dispatcher->replication_queue.not_full, NULL);
+    pthread_create(&dispatcher->replication_queue.worker, NULL, replication_worker, dispatcher);
+
+    dispatcher->flusher_shutdown = 0;
+    pthread_create(&dispatcher->flusher, NULL, batch_flusher, dispatcher);
+
+    dispatcher->ring_ready = trace_ring_open(&dispatcher->ring, 1) == 0;
+    if (!dispatcher->ring_ready) {
+        log_message(dispatcher, "WARN", "Trace ring unavailable, validator hand-off disabled");
+    }
+
+    // Seed the columnar field table from an earlier run's sidecar so flushes
+    // keep cumulative counts rather than restarting the profile.
+    field_columns_load(FIELD_COLUMNS_FILE);
 
     bson_t *index = BCON_NEW("attributes.trade_id", BCON_INT32(1), "_time", BCON_INT32(-1));
     bson_t *options = BCON_NEW("sparse", BCON_BOOL(true));
@@ -66,66 +361,754 @@ TraceDispatcher* init_dispatcher() {
     return dispatcher;
 }
 
-int dispatch_trace(TraceDispatcher *dispatcher, const char *region_id, const char *trace_json) {
+// Construction option: back per-trace BSON buffers with a bump arena that is
+// reset after every batch flush. Pass 0 for the default arena size.
+TraceDispatcher* init_dispatcher_with_arena(size_t arena_bytes) {
+    if (arena_bytes == 0) {
+        arena_bytes = ARENA_DEFAULT_BYTES;
+    }
+    trace_arena.base = (uint8_t *)malloc(arena_bytes);
+    if (trace_arena.base) {
+        trace_arena.capacity = arena_bytes;
+        trace_arena.used = 0;
+        bson_mem_set_vtable(&(bson_mem_vtable_t){arena_malloc, arena_calloc, arena_realloc, arena_free, {NULL}});
+    }
+    return init_dispatcher();
+}
+
+// Monotonic milliseconds for batch ages, retry backoff, and token refill:
+// time(NULL) only ticks once a second, which quantized the 200ms age flush
+// to ~1s. Document timestamps keep wall-clock time via wall_ms.
+static int64_t now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int64_t wall_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int find_region(TraceDispatcher *dispatcher, const char *region_id) {
+    uint32_t slot = region_hash_key(region_id) % REGION_HASH_SIZE;
+    for (int probes = 0; probes < REGION_HASH_SIZE; probes++) {
+        int entry = dispatcher->region_hash[slot];
+        if (entry == 0) {
+            return -1;
+        }
+        if (strcmp(dispatcher->regions[entry - 1].region_id, region_id) == 0) {
+            return entry - 1;
+        }
+        slot = (slot + 1) % REGION_HASH_SIZE;
+    }
+    return -1;
+}
+
+// Admission gate, checked before any per-trace work. A trace is admitted
+// when its region's token bucket has a token and the retry queue - the
+// bounded intake behind a struggling region - is not saturated; otherwise it
+// is shed immediately. Fail-fast shedding at the front door keeps a burst
+// from turning into the retry storm that amplifies load exactly when the
+// server is slow.
+static int admission_admit(TraceDispatcher *dispatcher, int region_idx) {
+    RegionConfig *region = &dispatcher->regions[region_idx];
+    int64_t now = now_ms();
+    uint64_t shed = 0;
+
+    // The bucket's refill/spend is a read-modify-write shared across ingest
+    // threads, so it runs under the region's batch mutex; the shed log is
+    // emitted after the unlock.
+    pthread_mutex_lock(&region->batch.mutex);
+    if (region->admission_refill_ms > 0) {
+        double elapsed_s = (double)(now - region->admission_refill_ms) / 1000.0;
+        region->admission_tokens += elapsed_s * region->admission_rate;
+        if (region->admission_tokens > region->admission_burst) {
+            region->admission_tokens = region->admission_burst;
+        }
+    }
+    region->admission_refill_ms = now;
+
+    if (region->admission_tokens < 1.0 ||
+        dispatcher->retry_queue.count >= RETRY_QUEUE_CAPACITY) {
+        shed = ++region->shed;
+    } else {
+        region->admission_tokens -= 1.0;
+        region->admitted++;
+    }
+    pthread_mutex_unlock(&region->batch.mutex);
+
+    if (shed > 0) {
+        if (shed % 1000 == 1) {
+            char msg[256];
+            snprintf(msg, sizeof(msg), "Shedding traces for %s (%llu shed so far)",
+                     region->region_id, (unsigned long long)shed);
+            log_message(dispatcher, "WARN", msg);
+        }
+        return -1;
+    }
+    return 0;
+}
+
+// Appends admission and queue-depth gauges to the Prometheus dump written by
+// perf_dump_to_file, so overload shows up next to the latency histograms.
+static void dump_admission_metrics(TraceDispatcher *dispatcher) {
+    FILE *output = fopen(METRICS_FILE, "a");
+    if (!output) {
+        return;
+    }
+    for (int i = 0; i < dispatcher->region_count; i++) {
+        RegionConfig *region = &dispatcher->regions[i];
+        fprintf(output, "zero0x_admission_admitted_total{region=\"%s\"} %llu\n",
+                region->region_id, (unsigned long long)region->admitted);
+        fprintf(output, "zero0x_admission_shed_total{region=\"%s\"} %llu\n",
+                region->region_id, (unsigned long long)region->shed);
+        fprintf(output, "zero0x_queue_depth{queue=\"batch\",region=\"%s\"} %zu\n",
+                region->region_id, region->batch.count);
+    }
+    fprintf(output, "zero0x_queue_depth{queue=\"retry\"} %zu\n", dispatcher->retry_queue.count);
+    fprintf(output, "zero0x_queue_depth{queue=\"replication\"} %zu\n", dispatcher->replication_queue.count);
+    fclose(output);
+}
+
+static void stamp_trace_doc(const char *region_id, bson_t *doc) {
+    // Stamp the schema version from the read-through cache over
+    // trace_schema_doc.json; "1.32" is the fallback until the schema doc
+    // generator has run at least once on this host.
+    char semconv_version[SCHEMA_CACHE_VERSION_MAX] = "1.32";
+    schema_cache_version(semconv_version, sizeof(semconv_version));
+
+    bson_t *attributes = bson_new();
+    BCON_APPEND(attributes, "region_id", BCON_UTF8(region_id), "semconv_version", BCON_UTF8(semconv_version));
+    BCON_APPEND(doc, "attributes", BCON_DOCUMENT(attributes), "_time", BCON_DATE_TIME(wall_ms()));
+    bson_destroy(attributes);
+}
+
+// On success the calling thread is left registered as an arena builder; the
+// caller must arena_builder_exit() once the document is batch-owned or
+// destroyed.
+static bson_t* build_trace_doc(TraceDispatcher *dispatcher, const char *region_id, const char *trace_json) {
     bson_error_t error;
+    arena_builder_enter();
     bson_t *doc = bson_new_from_json((const uint8_t *)trace_json, -1, &error);
     if (!doc) {
+        arena_builder_exit();
         log_message(dispatcher, "ERROR", error.message);
+        return NULL;
+    }
+
+    stamp_trace_doc(region_id, doc);
+    arena_builder_pause();
+    return doc;
+}
+
+// Mirrors the requirement checks in requirement_validator.c so the fused
+// ingest path can validate the already-parsed document in place instead of
+// round-tripping it through the validator's JSON entry point.
+static int validate_trace_doc(TraceDispatcher *dispatcher, const bson_t *doc) {
+    bson_iter_t iter;
+    bson_iter_t descent;
+
+    if (!bson_iter_init(&iter, doc) || !bson_iter_find_descendant(&iter, "attributes.trade_id", &descent)) {
+        log_message(dispatcher, "ERROR", "Missing trade_id");
         return -1;
     }
 
-    bson_t *attributes = bson_new();
-    BCON_APPEND(attributes, "region_id", BCON_UTF8(region_id), "semconv_version", BCON_UTF8("1.32"));
-    BCON_APPEND(doc, "attributes", BCON_DOCUMENT(attributes), "_time", BCON_DATE_TIME(time(NULL) * 1000));
+    if (bson_iter_init(&iter, doc) && bson_iter_find_descendant(&iter, "attributes.level", &descent)) {
+        const char *level = bson_iter_utf8(&descent, NULL);
+        if (strcmp(level, "info") != 0 && strcmp(level, "error") != 0 && strcmp(level, "warn") != 0) {
+            log_message(dispatcher, "ERROR", "Invalid log level");
+            return -1;
+        }
+    } else {
+        log_message(dispatcher, "ERROR", "Missing log level");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int64_t retry_backoff_ms(int attempts) {
+    int64_t delay = (int64_t)RETRY_BASE_DELAY_MS << attempts;
+    if (delay > RETRY_MAX_DELAY_MS) {
+        delay = RETRY_MAX_DELAY_MS;
+    }
+    return delay + rand() % RETRY_BASE_DELAY_MS;
+}
 
-    int region_idx = -1;
-    for (int i = 0; i < MAX_REGIONS; i++) {
-        if (strcmp(dispatcher->regions[i].region_id, region_id) == 0) {
-            region_idx = i;
+// Takes ownership of doc. The document must be heap-owned (not arena-backed),
+// because retry entries outlive the batch whose flush resets the arena.
+static int retry_push(TraceDispatcher *dispatcher, bson_t *doc, int region_idx, int attempts) {
+    RetryQueue *queue = &dispatcher->retry_queue;
+    pthread_mutex_lock(&queue->mutex);
+    if (queue->count == RETRY_QUEUE_CAPACITY) {
+        pthread_mutex_unlock(&queue->mutex);
+        log_message(dispatcher, "ERROR", "Retry queue full, dropping trace");
+        bson_destroy(doc);
+        return -1;
+    }
+    RetryEntry *entry = &queue->entries[queue->tail];
+    entry->doc = doc;
+    entry->region_idx = region_idx;
+    entry->attempts = attempts;
+    entry->next_attempt_ms = now_ms() + retry_backoff_ms(attempts);
+    queue->tail = (queue->tail + 1) % RETRY_QUEUE_CAPACITY;
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->mutex);
+    return 0;
+}
+
+// Dedicated retry thread: failed dispatches are serviced here with exponential
+// backoff and jitter so ingest threads never block on a slow region.
+static void* retry_worker(void *arg) {
+    TraceDispatcher *dispatcher = (TraceDispatcher *)arg;
+    RetryQueue *queue = &dispatcher->retry_queue;
+
+    for (;;) {
+        pthread_mutex_lock(&queue->mutex);
+        while (queue->count == 0 && !queue->shutdown) {
+            pthread_cond_wait(&queue->not_empty, &queue->mutex);
+        }
+        if (queue->count == 0 && queue->shutdown) {
+            pthread_mutex_unlock(&queue->mutex);
             break;
         }
+        RetryEntry entry = queue->entries[queue->head];
+        queue->head = (queue->head + 1) % RETRY_QUEUE_CAPACITY;
+        queue->count--;
+        pthread_mutex_unlock(&queue->mutex);
+
+        int64_t wait_ms = entry.next_attempt_ms - now_ms();
+        if (wait_ms > 0) {
+            usleep((useconds_t)(wait_ms * 1000));
+        }
+
+        RegionConfig *region = &dispatcher->regions[entry.region_idx];
+        mongoc_client_t *client = mongoc_client_pool_pop(region->pool);
+        mongoc_collection_t *collection = mongoc_client_get_collection(client, DB_NAME, COLLECTION_NAME);
+        bson_error_t error;
+        int ok = mongoc_collection_insert_one(collection, entry.doc, NULL, NULL, &error);
+        mongoc_collection_destroy(collection);
+        mongoc_client_pool_push(region->pool, client);
+
+        if (ok) {
+            char msg[256];
+            snprintf(msg, sizeof(msg), "Retried trace dispatched to %s after %d attempts", region->region_id, entry.attempts + 1);
+            log_message(dispatcher, "INFO", msg);
+            bson_destroy(entry.doc);
+        } else if (entry.attempts + 1 >= region->max_retries) {
+            log_message(dispatcher, "ERROR", "Max retries reached, dropping trace");
+            bson_destroy(entry.doc);
+        } else {
+            log_message(dispatcher, "WARN", error.message);
+            retry_push(dispatcher, entry.doc, entry.region_idx, entry.attempts + 1);
+        }
     }
-    if (region_idx == -1) {
-        log_message(dispatcher, "ERROR", "Invalid region ID");
+    return NULL;
+}
+
+// Takes ownership of doc. The document must be heap-owned, same rule as
+// retry_push: replication entries outlive any arena batch reset. Blocks when
+// the queue is full until the replication worker catches up.
+static int replication_push(TraceDispatcher *dispatcher, bson_t *doc, int region_idx) {
+    ReplicationQueue *queue = &dispatcher->replication_queue;
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == REPLICATION_QUEUE_CAPACITY && !queue->shutdown) {
+        pthread_cond_wait(&queue->not_full, &queue->mutex);
+    }
+    if (queue->shutdown) {
+        pthread_mutex_unlock(&queue->mutex);
         bson_destroy(doc);
         return -1;
     }
+    ReplicationEntry *entry = &queue->entries[queue->tail];
+    entry->doc = doc;
+    entry->region_idx = region_idx;
+    queue->tail = (queue->tail + 1) % REPLICATION_QUEUE_CAPACITY;
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->mutex);
+    return 0;
+}
+
+// Replication thread: drains the queue in per-region bulk writes of up to
+// REPLICATION_BATCH documents, so the remote-region copy costs one bulk
+// round trip per batch instead of one cross-Atlantic insert per trace.
+// Failed bulks fall through to the retry queue document by document.
+static void* replication_worker(void *arg) {
+    TraceDispatcher *dispatcher = (TraceDispatcher *)arg;
+    ReplicationQueue *queue = &dispatcher->replication_queue;
+    bson_t *docs[REPLICATION_BATCH];
+
+    for (;;) {
+        pthread_mutex_lock(&queue->mutex);
+        while (queue->count == 0 && !queue->shutdown) {
+            pthread_cond_wait(&queue->not_empty, &queue->mutex);
+        }
+        if (queue->count == 0 && queue->shutdown) {
+            pthread_mutex_unlock(&queue->mutex);
+            break;
+        }
+        int region_idx = queue->entries[queue->head].region_idx;
+        size_t batch_count = 0;
+        while (queue->count > 0 && batch_count < REPLICATION_BATCH &&
+               queue->entries[queue->head].region_idx == region_idx) {
+            docs[batch_count++] = queue->entries[queue->head].doc;
+            queue->head = (queue->head + 1) % REPLICATION_QUEUE_CAPACITY;
+            queue->count--;
+        }
+        pthread_cond_broadcast(&queue->not_full);
+        pthread_mutex_unlock(&queue->mutex);
+
+        RegionConfig *region = &dispatcher->regions[region_idx];
+        mongoc_client_t *client = mongoc_client_pool_pop(region->pool);
+        mongoc_collection_t *collection = mongoc_client_get_collection(client, DB_NAME, COLLECTION_NAME);
+        mongoc_bulk_operation_t *bulk = mongoc_collection_create_bulk_operation_with_opts(collection, NULL);
+        for (size_t i = 0; i < batch_count; i++) {
+            mongoc_bulk_operation_insert(bulk, docs[i]);
+        }
 
-    int retries = 0;
-    while (retries < dispatcher->regions[region_idx].max_retries) {
-        if (mongoc_collection_insert_one(dispatcher->collection, doc, NULL, NULL, &error)) {
+        bson_t reply;
+        bson_error_t error;
+        int ok = mongoc_bulk_operation_execute(bulk, &reply, &error);
+        bson_destroy(&reply);
+        mongoc_bulk_operation_destroy(bulk);
+        mongoc_collection_destroy(collection);
+        mongoc_client_pool_push(region->pool, client);
+
+        if (ok) {
             char msg[256];
-            snprintf(msg, sizeof(msg), "Trace dispatched to %s", region_id);
+            snprintf(msg, sizeof(msg), "Replicated batch of %zu traces to %s", batch_count, region->region_id);
             log_message(dispatcher, "INFO", msg);
-            bson_destroy(doc);
-            return 0;
+            for (size_t i = 0; i < batch_count; i++) {
+                bson_destroy(docs[i]);
+            }
+        } else {
+            log_message(dispatcher, "WARN", error.message);
+            for (size_t i = 0; i < batch_count; i++) {
+                retry_push(dispatcher, docs[i], region_idx, 1);
+            }
+        }
+    }
+    return NULL;
+}
+
+// The arena backs trace documents across all regions, so it may only be
+// reset once no region has a pending batch and no ingest thread is mid-build
+// (a builder's document is not in any batch yet). The CAS takes the reset
+// bit only when the builder count is zero, and holding the bit keeps new
+// builders out, so no document can be built or enqueued between the batch
+// checks and the rewind.
+static void arena_reset_if_idle(TraceDispatcher *dispatcher) {
+    uint32_t expected = 0;
+    if (!__atomic_compare_exchange_n(&arena_gate, &expected, ARENA_RESET_BIT, 0,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;
+    }
+    for (int i = 0; i < dispatcher->region_count; i++) {
+        if (__atomic_load_n(&dispatcher->regions[i].batch.count, __ATOMIC_ACQUIRE) > 0) {
+            __atomic_store_n(&arena_gate, 0, __ATOMIC_RELEASE);
+            return;
+        }
+    }
+    arena_reset();
+    __atomic_store_n(&arena_gate, 0, __ATOMIC_RELEASE);
+}
+
+// Snapshots and empties the batch under its mutex, then runs the bulk write
+// outside the lock so a slow region never blocks concurrent enqueues longer
+// than the pointer copy.
+int flush_trace_batch(TraceDispatcher *dispatcher, int region_idx) {
+    RegionConfig *region = &dispatcher->regions[region_idx];
+    TraceBatch *batch = &region->batch;
+    bson_t *docs[BATCH_CAPACITY];
+    size_t count;
+
+    pthread_mutex_lock(&batch->mutex);
+    count = batch->count;
+    if (count == 0) {
+        pthread_mutex_unlock(&batch->mutex);
+        return 0;
+    }
+    memcpy(docs, batch->docs, count * sizeof(bson_t *));
+    batch->count = 0;
+    batch->oldest_ms = 0;
+    pthread_mutex_unlock(&batch->mutex);
+
+    bson_error_t error;
+    mongoc_client_t *client = mongoc_client_pool_pop(region->pool);
+    mongoc_collection_t *collection = mongoc_client_get_collection(client, DB_NAME, COLLECTION_NAME);
+    mongoc_bulk_operation_t *bulk = mongoc_collection_create_bulk_operation_with_opts(collection, NULL);
+    for (size_t i = 0; i < count; i++) {
+        mongoc_bulk_operation_insert(bulk, docs[i]);
+    }
+
+    bson_t reply;
+    int ok = mongoc_bulk_operation_execute(bulk, &reply, &error);
+    if (ok) {
+        char msg[256];
+        snprintf(msg, sizeof(msg), "Flushed batch of %zu traces to %s", count, region->region_id);
+        log_message(dispatcher, "INFO", msg);
+    } else {
+        log_message(dispatcher, "ERROR", error.message);
+    }
+
+    bson_destroy(&reply);
+    mongoc_bulk_operation_destroy(bulk);
+    mongoc_collection_destroy(collection);
+    mongoc_client_pool_push(region->pool, client);
+    for (size_t i = 0; i < count; i++) {
+        bson_destroy(docs[i]);
+    }
+    arena_reset_if_idle(dispatcher);
+    return ok ? 0 : -1;
+}
+
+int flush_all_batches(TraceDispatcher *dispatcher) {
+    int rc = 0;
+    for (int i = 0; i < dispatcher->region_count; i++) {
+        if (flush_trace_batch(dispatcher, i) != 0) {
+            rc = -1;
         }
-        retries++;
-        log_message(dispatcher, "WARN", error.message);
     }
+    return rc;
+}
+
+// Periodic flusher: the age-based flush used to fire only on the next
+// enqueue, so a region's tail batch could sit unflushed through a traffic
+// pause. This thread sweeps every region each BATCH_MAX_AGE_MS and flushes
+// any batch that has aged out.
+static void* batch_flusher(void *arg) {
+    TraceDispatcher *dispatcher = (TraceDispatcher *)arg;
+    while (!__atomic_load_n(&dispatcher->flusher_shutdown, __ATOMIC_ACQUIRE)) {
+        usleep(BATCH_MAX_AGE_MS * 1000);
+        for (int i = 0; i < dispatcher->region_count; i++) {
+            TraceBatch *batch = &dispatcher->regions[i].batch;
+            pthread_mutex_lock(&batch->mutex);
+            int stale = batch->count > 0 && now_ms() - batch->oldest_ms >= BATCH_MAX_AGE_MS;
+            pthread_mutex_unlock(&batch->mutex);
+            if (stale) {
+                flush_trace_batch(dispatcher, i);
+            }
+        }
+    }
+    return NULL;
+}
 
-    log_message(dispatcher, "ERROR", "Max retries reached");
+// Records one columnar observation per top-level field of the ingested
+// trace — the same key set the fixer's $objectToArray-on-$$ROOT fallback
+// profiles, so field counts and mixed-type detection agree whichever path
+// produced them. The sidecar is flushed every FIELD_FLUSH_EVERY docs and
+// at shutdown.
+#define FIELD_FLUSH_EVERY 1000
+
+static void record_trace_fields(const bson_t *doc) {
+    static uint64_t docs_recorded = 0;
+
+    bson_iter_t iter;
+    if (!bson_iter_init(&iter, doc)) {
+        return;
+    }
+    while (bson_iter_next(&iter)) {
+        field_columns_record(bson_iter_key(&iter), (int)bson_iter_type(&iter));
+    }
+
+    if (__atomic_add_fetch(&docs_recorded, 1, __ATOMIC_RELAXED) % FIELD_FLUSH_EVERY == 0) {
+        field_columns_flush(FIELD_COLUMNS_FILE);
+    }
+}
+
+// Per-region batching: a slow region fills and flushes its own batch without
+// interleaving with (or stalling) traffic bound for any other region. The
+// append runs under the batch mutex; size- and age-triggered flushes happen
+// after the lock is dropped (concurrent flushes are safe - whoever gets
+// there first takes the snapshot).
+static int enqueue_trace_doc(TraceDispatcher *dispatcher, int region_idx, bson_t *doc) {
+    record_trace_fields(doc);
+    TraceBatch *batch = &dispatcher->regions[region_idx].batch;
+
+    pthread_mutex_lock(&batch->mutex);
+    if (batch->count == 0) {
+        batch->oldest_ms = now_ms();
+    }
+    batch->docs[batch->count++] = doc;
+    int should_flush = batch->count >= BATCH_CAPACITY || now_ms() - batch->oldest_ms >= BATCH_MAX_AGE_MS;
+    pthread_mutex_unlock(&batch->mutex);
+
+    if (should_flush) {
+        return flush_trace_batch(dispatcher, region_idx);
+    }
+    return 0;
+}
+
+int enqueue_trace(TraceDispatcher *dispatcher, const char *region_id, const char *trace_json) {
+    int region_idx = find_region(dispatcher, region_id);
+    if (region_idx == -1) {
+        log_message(dispatcher, "ERROR", "Invalid region ID");
+        return -1;
+    }
+    if (admission_admit(dispatcher, region_idx) != 0) {
+        return -1;
+    }
+
+    bson_t *doc = build_trace_doc(dispatcher, region_id, trace_json);
+    if (!doc) {
+        return -1;
+    }
+
+    int rc = enqueue_trace_doc(dispatcher, region_idx, doc);
+    arena_builder_exit();
+    return rc;
+}
+
+// Drains validated BSON frames published by the validator process through the
+// shared memory-mapped ring. Frames are viewed in place (bson_init_static) -
+// the only copy made is the one the batch queue must own past the frame's
+// lifetime. Returns the number of traces drained.
+int drain_trace_ring(TraceDispatcher *dispatcher, const char *region_id) {
+    int region_idx = find_region(dispatcher, region_id);
+    if (!dispatcher->ring_ready || region_idx == -1) {
+        return 0;
+    }
+
+    int drained = 0;
+    uint32_t frame_len = 0;
+    const uint8_t *frame;
+    while ((frame = trace_ring_front(&dispatcher->ring, &frame_len)) != NULL) {
+        bson_t view;
+        if (bson_init_static(&view, frame, frame_len)) {
+            bson_t *doc = bson_copy(&view);
+            stamp_trace_doc(region_id, doc);
+            enqueue_trace_doc(dispatcher, region_idx, doc);
+            drained++;
+        } else {
+            log_message(dispatcher, "ERROR", "Corrupt frame in trace ring");
+        }
+        trace_ring_release(&dispatcher->ring, frame_len);
+    }
+    return drained;
+}
+
+// Fused ingest stage: one JSON parse, validation in place, region stamping on
+// the same bson_t, and hand-off to the batch queue for one bulk insert. The
+// old flow parsed every trace twice and inserted it twice (once from the
+// validator, once from the dispatcher).
+int ingest_trace(TraceDispatcher *dispatcher, const char *region_id, const char *trace_json) {
+    static int perf_site = -1;
+    if (perf_site < 0) perf_site = perf_register("ingest_trace");
+    uint64_t perf_start = perf_now_ns();
+
+    int region_idx = find_region(dispatcher, region_id);
+    if (region_idx == -1) {
+        log_message(dispatcher, "ERROR", "Invalid region ID");
+        return -1;
+    }
+    if (admission_admit(dispatcher, region_idx) != 0) {
+        return -1;
+    }
+
+    bson_error_t error;
+    arena_builder_enter();
+    bson_t *doc = bson_new_from_json((const uint8_t *)trace_json, -1, &error);
+    if (!doc) {
+        arena_builder_exit();
+        log_message(dispatcher, "ERROR", error.message);
+        return -1;
+    }
+
+    if (validate_trace_doc(dispatcher, doc) != 0) {
+        bson_destroy(doc);
+        arena_builder_exit();
+        return -1;
+    }
+
+    stamp_trace_doc(region_id, doc);
+    arena_builder_pause();
+    int rc = enqueue_trace_doc(dispatcher, region_idx, doc);
+    arena_builder_exit();
+    perf_record(perf_site, perf_start);
+    return rc;
+}
+
+// Geo-aware dual-region path for traces that span regions (e.g. SOL/ETH
+// arbitrage flows): the home-region write goes through the normal synchronous
+// batch, while the remote-region copy rides the async replication queue. The
+// caller no longer pays the second cross-Atlantic round trip inline. The
+// replica is a faithful copy of the home-stamped document, only stored in
+// the second region.
+int ingest_trace_dual(TraceDispatcher *dispatcher, const char *home_region_id,
+                      const char *remote_region_id, const char *trace_json) {
+    static int perf_site = -1;
+    if (perf_site < 0) perf_site = perf_register("ingest_trace_dual");
+    uint64_t perf_start = perf_now_ns();
+
+    int home_idx = find_region(dispatcher, home_region_id);
+    int remote_idx = find_region(dispatcher, remote_region_id);
+    if (home_idx == -1 || remote_idx == -1) {
+        log_message(dispatcher, "ERROR", "Invalid region ID");
+        return -1;
+    }
+    // Only the home region gates admission: the remote copy rides the
+    // bounded replication queue, which applies its own backpressure.
+    if (admission_admit(dispatcher, home_idx) != 0) {
+        return -1;
+    }
+
+    bson_error_t error;
+    arena_builder_enter();
+    bson_t *doc = bson_new_from_json((const uint8_t *)trace_json, -1, &error);
+    if (!doc) {
+        arena_builder_exit();
+        log_message(dispatcher, "ERROR", error.message);
+        return -1;
+    }
+
+    if (validate_trace_doc(dispatcher, doc) != 0) {
+        bson_destroy(doc);
+        arena_builder_exit();
+        return -1;
+    }
+
+    stamp_trace_doc(home_region_id, doc);
+    arena_builder_pause();
+
+    // Heap-owned copy made outside arena scope; the replication queue takes
+    // ownership and the entry survives any batch flush that resets the arena.
+    bson_t *replica = bson_copy(doc);
+    replication_push(dispatcher, replica, remote_idx);
+
+    int rc = enqueue_trace_doc(dispatcher, home_idx, doc);
+    arena_builder_exit();
+    perf_record(perf_site, perf_start);
+    return rc;
+}
+
+int dispatch_trace(TraceDispatcher *dispatcher, const char *region_id, const char *trace_json) {
+    static int perf_site = -1;
+    if (perf_site < 0) perf_site = perf_register("dispatch_trace");
+    uint64_t perf_start = perf_now_ns();
+
+    bson_error_t error;
+    int region_idx = find_region(dispatcher, region_id);
+    if (region_idx == -1) {
+        log_message(dispatcher, "ERROR", "Invalid region ID");
+        return -1;
+    }
+    if (admission_admit(dispatcher, region_idx) != 0) {
+        return -1;
+    }
+
+    bson_t *doc = build_trace_doc(dispatcher, region_id, trace_json);
+    if (!doc) {
+        return -1;
+    }
+
+    RegionConfig *region = &dispatcher->regions[region_idx];
+    mongoc_client_t *client = mongoc_client_pool_pop(region->pool);
+    mongoc_collection_t *collection = mongoc_client_get_collection(client, DB_NAME, COLLECTION_NAME);
+
+    if (mongoc_collection_insert_one(collection, doc, NULL, NULL, &error)) {
+        char msg[256];
+        snprintf(msg, sizeof(msg), "Trace dispatched to %s", region_id);
+        log_message(dispatcher, "INFO", msg);
+        mongoc_collection_destroy(collection);
+        mongoc_client_pool_push(region->pool, client);
+        bson_destroy(doc);
+        arena_builder_exit();
+        perf_record(perf_site, perf_start);
+        return 0;
+    }
+
+    // One synchronous attempt only: a failed dispatch moves to the retry
+    // queue and the caller gets control back immediately instead of blocking
+    // through max_retries on a slow region.
+    log_message(dispatcher, "WARN", error.message);
+    mongoc_collection_destroy(collection);
+    mongoc_client_pool_push(region->pool, client);
+
+    bson_t *retry_doc = bson_copy(doc);
     bson_destroy(doc);
-    return -1;
+    arena_builder_exit();
+    perf_record(perf_site, perf_start);
+    return retry_push(dispatcher, retry_doc, region_idx, 1);
 }
 
 void cleanup_dispatcher(TraceDispatcher *dispatcher) {
     if (dispatcher) {
+        __atomic_store_n(&dispatcher->flusher_shutdown, 1, __ATOMIC_RELEASE);
+        pthread_join(dispatcher->flusher, NULL);
+
+        flush_all_batches(dispatcher);
+        field_columns_flush(FIELD_COLUMNS_FILE);
+        perf_dump_to_file(METRICS_FILE);
+        dump_admission_metrics(dispatcher);
+
+        // Replication drains before the retry queue so its failed bulks can
+        // still fall through to one last retry pass.
+        pthread_mutex_lock(&dispatcher->replication_queue.mutex);
+        dispatcher->replication_queue.shutdown = 1;
+        pthread_cond_broadcast(&dispatcher->replication_queue.not_empty);
+        pthread_cond_broadcast(&dispatcher->replication_queue.not_full);
+        pthread_mutex_unlock(&dispatcher->replication_queue.mutex);
+        pthread_join(dispatcher->replication_queue.worker, NULL);
+        pthread_mutex_destroy(&dispatcher->replication_queue.mutex);
+        pthread_cond_destroy(&dispatcher->replication_queue.not_empty);
+        pthread_cond_destroy(&dispatcher->replication_queue.not_full);
+
+        pthread_mutex_lock(&dispatcher->retry_queue.mutex);
+        dispatcher->retry_queue.shutdown = 1;
+        pthread_cond_broadcast(&dispatcher->retry_queue.not_empty);
+        pthread_mutex_unlock(&dispatcher->retry_queue.mutex);
+        pthread_join(dispatcher->retry_queue.worker, NULL);
+        pthread_mutex_destroy(&dispatcher->retry_queue.mutex);
+        pthread_cond_destroy(&dispatcher->retry_queue.not_empty);
+
+        if (dispatcher->ring_ready) {
+            trace_ring_close(&dispatcher->ring);
+        }
+
+        for (int i = 0; i < dispatcher->region_count; i++) {
+            if (dispatcher->regions[i].pool) {
+                mongoc_client_pool_destroy(dispatcher->regions[i].pool);
+            }
+            pthread_mutex_destroy(&dispatcher->regions[i].batch.mutex);
+        }
         mongoc_collection_destroy(dispatcher->collection);
         mongoc_client_destroy(dispatcher->client);
         mongoc_cleanup();
+        binlog_shutdown();
         fclose(dispatcher->log_file);
         free(dispatcher);
+        if (trace_arena.base) {
+            free(trace_arena.base);
+            trace_arena.base = NULL;
+            trace_arena.capacity = 0;
+            trace_arena.used = 0;
+        }
     }
 }
 
 int main() {
-    TraceDispatcher *dispatcher = init_dispatcher();
+    TraceDispatcher *dispatcher = init_dispatcher_with_arena(0);
     if (!dispatcher) return 1;
 
-    const char *trace = "{\"attributes\":{\"trade_type\":\"arbitrage\",\"trade_id\":\"123\"}}";
-    if (dispatch_trace(dispatcher, "US", trace) != 0) {
-        printf("Failed to dispatch trace to US\n");
+    const char *trace = "{\"attributes\":{\"trade_type\":\"arbitrage\",\"trade_id\":\"123\",\"level\":\"info\"}}";
+    if (ingest_trace(dispatcher, "US", trace) != 0) {
+        printf("Failed to ingest trace for US\n");
+    }
+
+    // Cross-region flow: synchronous write lands in US, the EU copy rides
+    // the async replication queue.
+    const char *dual_trace = "{\"attributes\":{\"trade_type\":\"arbitrage\",\"trade_id\":\"124\",\"level\":\"info\",\"chain\":\"sol-eth\"}}";
+    if (ingest_trace_dual(dispatcher, "US", "EU", dual_trace) != 0) {
+        printf("Failed to ingest cross-region trace\n");
+    }
+
+    drain_trace_ring(dispatcher, "US");
+    if (flush_all_batches(dispatcher) != 0) {
+        printf("Failed to flush trace batches\n");
     }
 
     cleanup_dispatcher(dispatcher);
@@ -4,17 +4,29 @@
 #include <string.h>
 #include <time.h>
 
+#include "trace_ring_buffer.h"
+#include "../../perf_metrics.h"
+#include "../../binlog.h"
+#include "../../schema_cache.h"
+
 #define MONGO_URI "mongodb://localhost:27017"
+#define METRICS_FILE "validator_metrics.prom"
 #define DB_NAME "zero0x_db"
 #define COLLECTION_NAME "traces"
 
 typedef struct {
     mongoc_client_t *client;
     mongoc_collection_t *collection;
+    TraceRing ring;
+    int ring_ready;
     FILE *log_file;
 } RequirementValidator;
 
 void log_message(RequirementValidator *validator, const char *level, const char *msg) {
+    if (binlog_ready()) {
+        binlog_write(binlog_level_from_string(level), msg);
+        return;
+    }
     time_t now = time(NULL);
     fprintf(validator->log_file, "[%s] %s: %s\n", ctime(&now), level, msg);
     fflush(validator->log_file);
@@ -32,6 +44,7 @@ RequirementValidator* init_validator() {
         free(validator);
         return NULL;
     }
+    binlog_init("validator.binlog");
 
     mongoc_init();
     validator->client = mongoc_client_new(MONGO_URI);
@@ -44,43 +57,186 @@ RequirementValidator* init_validator() {
     }
 
     validator->collection = mongoc_client_get_collection(validator->client, DB_NAME, COLLECTION_NAME);
+    validator->ring_ready = trace_ring_open(&validator->ring, 1) == 0;
+    if (!validator->ring_ready) {
+        log_message(validator, "WARN", "Trace ring unavailable, falling back to direct insert");
+    }
+    // Schema metadata comes from the read-through cache over
+    // trace_schema_doc.json instead of a startup query against the
+    // trace_schema collection.
+    char schema_version[SCHEMA_CACHE_VERSION_MAX];
+    if (schema_cache_version(schema_version, sizeof(schema_version)) == 0) {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "Schema cache ready, version %s", schema_version);
+        log_message(validator, "INFO", msg);
+    } else {
+        log_message(validator, "WARN", "Schema cache unavailable, no schema doc on disk");
+    }
+
     log_message(validator, "INFO", "Validator initialized");
     return validator;
 }
 
-int validate_requirements(RequirementValidator *validator, const char *trace_json) {
-    bson_error_t error;
-    bson_t *doc = bson_new_from_json((const uint8_t *)trace_json, -1, &error);
-    if (!doc) {
-        log_message(validator, "ERROR", error.message);
-        return -1;
+// SWAR validation kernel for short enum-valued attributes (level, and soon
+// trade_type / chain). Each candidate string of up to 8 bytes is packed into
+// one uint64_t, well-formedness reduces to a mask test (valid members are
+// 7-bit ASCII, so any high bit means a malformed or non-member value), and
+// enum membership is one 64-bit compare per member instead of a strcmp chain.
+
+#define SWAR_HIGH_BITS 0x8080808080808080ull
+#define VALID_LEVEL_COUNT 3
+
+static const char *VALID_LEVELS[VALID_LEVEL_COUNT] = {"info", "error", "warn"};
+static uint64_t valid_level_packed[VALID_LEVEL_COUNT];
+static int valid_level_ready = 0;
+
+static uint64_t swar_pack(const char *str, uint32_t len) {
+    uint64_t packed = 0;
+    memcpy(&packed, str, len <= 8 ? len : 8);
+    return packed;
+}
+
+static void init_level_enum() {
+    for (int i = 0; i < VALID_LEVEL_COUNT; i++) {
+        valid_level_packed[i] = swar_pack(VALID_LEVELS[i], (uint32_t)strlen(VALID_LEVELS[i]));
     }
+    valid_level_ready = 1;
+}
+
+static void swar_validate_enum(const uint64_t *packed, size_t count,
+                               const uint64_t *enum_set, size_t enum_count, int *ok) {
+    for (size_t i = 0; i < count; i++) {
+        uint64_t value = packed[i];
+        int well_formed = (value & SWAR_HIGH_BITS) == 0;
+        int member = 0;
+        for (size_t e = 0; e < enum_count; e++) {
+            member |= (value == enum_set[e]);
+        }
+        ok[i] = well_formed && member;
+    }
+}
+
+// Zero-copy fast path: checks a caller-owned bson_t (e.g. a view over the
+// dispatcher's wire batch) with bson_iter_t descent only. No allocation, no
+// parse, no insert - the caller keeps ownership and decides what to do with
+// the validated document.
+int validate_requirements_bson(RequirementValidator *validator, const bson_t *doc) {
+    static int perf_site = -1;
+    if (perf_site < 0) perf_site = perf_register("validate_requirements");
+    uint64_t perf_start = perf_now_ns();
 
-    // Requirement 1: Data format (must have attributes.trade_id)
     bson_iter_t iter;
-    if (!bson_iter_init_find(&iter, doc, "attributes.trade_id")) {
+    bson_iter_t descent;
+
+    // Requirement 1: Data format (must have attributes.trade_id)
+    if (!bson_iter_init(&iter, doc) || !bson_iter_find_descendant(&iter, "attributes.trade_id", &descent)) {
         log_message(validator, "ERROR", "Missing trade_id");
-        bson_destroy(doc);
         return -1;
     }
 
     // Requirement 2: Timestamp (_time must be present)
     if (!bson_iter_init_find(&iter, doc, "_time")) {
         log_message(validator, "ERROR", "Missing _time field");
-        bson_destroy(doc);
         return -1;
     }
 
     // Requirement 3: Log level (attributes.level must be valid)
-    if (bson_iter_init_find(&iter, doc, "attributes.level")) {
-        const char *level = bson_iter_utf8(&iter, NULL);
-        if (strcmp(level, "info") != 0 && strcmp(level, "error") != 0 && strcmp(level, "warn") != 0) {
+    if (bson_iter_init(&iter, doc) && bson_iter_find_descendant(&iter, "attributes.level", &descent)) {
+        uint32_t level_len = 0;
+        const char *level = bson_iter_utf8(&descent, &level_len);
+        uint64_t packed = level_len <= 8 ? swar_pack(level, level_len) : SWAR_HIGH_BITS;
+        int level_ok = 0;
+        if (!valid_level_ready) init_level_enum();
+        swar_validate_enum(&packed, 1, valid_level_packed, VALID_LEVEL_COUNT, &level_ok);
+        if (!level_ok) {
             log_message(validator, "ERROR", "Invalid log level");
-            bson_destroy(doc);
             return -1;
         }
     } else {
         log_message(validator, "ERROR", "Missing log level");
+        return -1;
+    }
+
+    perf_record(perf_site, perf_start);
+    return 0;
+}
+
+// Batch fast path: validates a caller-owned array of documents in chunks.
+// The structural checks (trade_id / _time descent) run per document, but the
+// level strings are gathered into a packed array and the enum kernel runs
+// over the whole chunk at once. results[i] is 0 for a valid trace and -1
+// otherwise; the return value is the number of valid traces.
+#define BULK_CHUNK 8
+
+size_t validate_requirements_bulk(RequirementValidator *validator, const bson_t **traces,
+                                  size_t n_traces, int *results) {
+    static int perf_site = -1;
+    if (perf_site < 0) perf_site = perf_register("validate_requirements_bulk");
+    uint64_t perf_start = perf_now_ns();
+
+    if (!valid_level_ready) init_level_enum();
+
+    size_t valid = 0;
+    for (size_t base = 0; base < n_traces; base += BULK_CHUNK) {
+        size_t chunk = n_traces - base < BULK_CHUNK ? n_traces - base : BULK_CHUNK;
+        uint64_t packed[BULK_CHUNK];
+        int level_ok[BULK_CHUNK];
+
+        // Gather pass: structural checks and level extraction.
+        for (size_t i = 0; i < chunk; i++) {
+            const bson_t *doc = traces[base + i];
+            bson_iter_t iter;
+            bson_iter_t descent;
+            packed[i] = SWAR_HIGH_BITS;
+            results[base + i] = -1;
+
+            if (!bson_iter_init(&iter, doc) ||
+                !bson_iter_find_descendant(&iter, "attributes.trade_id", &descent)) {
+                continue;
+            }
+            if (!bson_iter_init_find(&iter, doc, "_time")) {
+                continue;
+            }
+            if (bson_iter_init(&iter, doc) &&
+                bson_iter_find_descendant(&iter, "attributes.level", &descent)) {
+                uint32_t level_len = 0;
+                const char *level = bson_iter_utf8(&descent, &level_len);
+                if (level_len <= 8) {
+                    packed[i] = swar_pack(level, level_len);
+                }
+            }
+            results[base + i] = 0;
+        }
+
+        // Kernel pass: one sweep over the gathered chunk.
+        swar_validate_enum(packed, chunk, valid_level_packed, VALID_LEVEL_COUNT, level_ok);
+        for (size_t i = 0; i < chunk; i++) {
+            if (results[base + i] == 0 && !level_ok[i]) {
+                results[base + i] = -1;
+            }
+            if (results[base + i] == 0) {
+                valid++;
+            }
+        }
+    }
+
+    if (valid < n_traces) {
+        log_message(validator, "ERROR", "Bulk validation rejected traces");
+    }
+    perf_record(perf_site, perf_start);
+    return valid;
+}
+
+// JSON entry point: the only path that pays for a parse and heap allocation.
+int validate_requirements(RequirementValidator *validator, const char *trace_json) {
+    bson_error_t error;
+    bson_t *doc = bson_new_from_json((const uint8_t *)trace_json, -1, &error);
+    if (!doc) {
+        log_message(validator, "ERROR", error.message);
+        return -1;
+    }
+
+    if (validate_requirements_bson(validator, doc) != 0) {
         bson_destroy(doc);
         return -1;
     }
@@ -96,11 +252,48 @@ int validate_requirements(RequirementValidator *validator, const char *trace_jso
     return 0;
 }
 
+// Ring transport entry point: parse once, validate in place, and hand the raw
+// BSON frame to the dispatcher through the shared ring. No JSON
+// re-serialization between the two processes.
+int validate_and_publish(RequirementValidator *validator, const char *trace_json) {
+    bson_error_t error;
+    bson_t *doc = bson_new_from_json((const uint8_t *)trace_json, -1, &error);
+    if (!doc) {
+        log_message(validator, "ERROR", error.message);
+        return -1;
+    }
+
+    if (validate_requirements_bson(validator, doc) != 0) {
+        bson_destroy(doc);
+        return -1;
+    }
+
+    if (!validator->ring_ready) {
+        bson_destroy(doc);
+        return validate_requirements(validator, trace_json);
+    }
+
+    if (trace_ring_push(&validator->ring, bson_get_data(doc), doc->len) != 0) {
+        log_message(validator, "ERROR", "Trace ring full");
+        bson_destroy(doc);
+        return -1;
+    }
+
+    log_message(validator, "INFO", "Trace validated and published to ring");
+    bson_destroy(doc);
+    return 0;
+}
+
 void cleanup_validator(RequirementValidator *validator) {
     if (validator) {
+        perf_dump_to_file(METRICS_FILE);
+        if (validator->ring_ready) {
+            trace_ring_close(&validator->ring);
+        }
         mongoc_collection_destroy(validator->collection);
         mongoc_client_destroy(validator->client);
         mongoc_cleanup();
+        binlog_shutdown();
         fclose(validator->log_file);
         free(validator);
     }
@@ -111,10 +304,25 @@ int main() {
     if (!validator) return 1;
 
     const char *trace = "{\"attributes\":{\"trade_id\":\"123\",\"level\":\"info\",\"trade_type\":\"arbitrage\"},\"_time\":1697059200000}";
-    if (validate_requirements(validator, trace) != 0) {
+    if (validate_and_publish(validator, trace) != 0) {
         printf("Validation failed\n");
     }
 
+    const char *batch_json[] = {
+        "{\"attributes\":{\"trade_id\":\"124\",\"level\":\"warn\"},\"_time\":1697059201000}",
+        "{\"attributes\":{\"trade_id\":\"125\",\"level\":\"debug\"},\"_time\":1697059202000}",
+    };
+    bson_t *batch_docs[2];
+    int batch_results[2];
+    for (int i = 0; i < 2; i++) {
+        batch_docs[i] = bson_new_from_json((const uint8_t *)batch_json[i], -1, NULL);
+    }
+    size_t valid = validate_requirements_bulk(validator, (const bson_t **)batch_docs, 2, batch_results);
+    printf("Bulk validation: %zu of 2 traces valid\n", valid);
+    for (int i = 0; i < 2; i++) {
+        bson_destroy(batch_docs[i]);
+    }
+
     cleanup_validator(validator);
     return 0;
 }
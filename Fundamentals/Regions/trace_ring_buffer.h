@@ -0,0 +1,163 @@
+#ifndef TRACE_RING_BUFFER_H
+#define TRACE_RING_BUFFER_H
+
+/*
+ * Memory-mapped single-producer/single-consumer ring buffer carrying raw BSON
+ * frames between the validator and dispatcher processes. The producer pushes
+ * the exact bytes of a validated bson_t; the consumer reads frames in place
+ * (trace_ring_front / trace_ring_release), so a trace crosses the process
+ * boundary with zero copies and no JSON round trip.
+ *
+ * Frame layout: uint32_t length followed by the BSON bytes, padded to 4-byte
+ * alignment. A length of UINT32_MAX marks unused space before a wrap back to
+ * the start of the data area.
+ */
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define TRACE_RING_NAME "/zero0x_trace_ring"
+#define TRACE_RING_BYTES (16 * 1024 * 1024)
+#define TRACE_RING_MAGIC 0x54524E47u
+#define TRACE_RING_ALIGN(n) (((n) + 3u) & ~3u)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t capacity;
+    _Atomic uint64_t head;
+    _Atomic uint64_t tail;
+} TraceRingHeader;
+
+typedef struct {
+    TraceRingHeader *header;
+    uint8_t *data;
+} TraceRing;
+
+/* Exactly one process initializes the header: O_EXCL decides the winner when
+ * both sides cold-start with create set, and the loser (like any non-creating
+ * opener) waits briefly for the winner to publish the magic before using the
+ * ring. */
+static int trace_ring_open(TraceRing *ring, int create) {
+    int initializing = 0;
+    int fd = -1;
+    if (create) {
+        fd = shm_open(TRACE_RING_NAME, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd >= 0) {
+            initializing = 1;
+        }
+    }
+    if (fd < 0) {
+        fd = shm_open(TRACE_RING_NAME, O_RDWR, 0600);
+    }
+    if (fd < 0) {
+        return -1;
+    }
+
+    size_t total = sizeof(TraceRingHeader) + TRACE_RING_BYTES;
+    if (initializing && ftruncate(fd, (off_t)total) != 0) {
+        close(fd);
+        shm_unlink(TRACE_RING_NAME);
+        return -1;
+    }
+
+    void *mem = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        return -1;
+    }
+
+    ring->header = (TraceRingHeader *)mem;
+    ring->data = (uint8_t *)mem + sizeof(TraceRingHeader);
+    if (initializing) {
+        ring->header->capacity = TRACE_RING_BYTES;
+        atomic_store(&ring->header->head, 0);
+        atomic_store(&ring->header->tail, 0);
+        /* Published last: openers below treat the magic as the ready flag. */
+        ring->header->magic = TRACE_RING_MAGIC;
+    } else {
+        for (int i = 0; i < 100 && *(volatile uint32_t *)&ring->header->magic != TRACE_RING_MAGIC; i++) {
+            usleep(1000);
+        }
+    }
+    return ring->header->magic == TRACE_RING_MAGIC ? 0 : -1;
+}
+
+static void trace_ring_close(TraceRing *ring) {
+    if (ring->header) {
+        munmap(ring->header, sizeof(TraceRingHeader) + TRACE_RING_BYTES);
+        ring->header = NULL;
+        ring->data = NULL;
+    }
+}
+
+/* Producer side: appends one BSON frame. Returns -1 when the ring is full. */
+static int trace_ring_push(TraceRing *ring, const uint8_t *bson_data, uint32_t bson_len) {
+    uint32_t capacity = ring->header->capacity;
+    uint64_t head = atomic_load_explicit(&ring->header->head, memory_order_acquire);
+    uint64_t tail = atomic_load_explicit(&ring->header->tail, memory_order_relaxed);
+    uint32_t needed = TRACE_RING_ALIGN(sizeof(uint32_t) + bson_len);
+    uint32_t offset = (uint32_t)(tail % capacity);
+
+    if (offset + needed > capacity) {
+        uint32_t skip = capacity - offset;
+        if (tail + skip + needed - head > capacity) {
+            return -1;
+        }
+        *(uint32_t *)(ring->data + offset) = UINT32_MAX;
+        tail += skip;
+        offset = 0;
+    } else if (tail + needed - head > capacity) {
+        return -1;
+    }
+
+    *(uint32_t *)(ring->data + offset) = bson_len;
+    memcpy(ring->data + offset + sizeof(uint32_t), bson_data, bson_len);
+    atomic_store_explicit(&ring->header->tail, tail + needed, memory_order_release);
+    return 0;
+}
+
+/* Consumer side: returns a pointer to the next frame's BSON bytes without
+ * copying, or NULL when the ring is empty. The frame stays valid until
+ * trace_ring_release is called. */
+static const uint8_t* trace_ring_front(TraceRing *ring, uint32_t *bson_len) {
+    uint32_t capacity = ring->header->capacity;
+    uint64_t tail = atomic_load_explicit(&ring->header->tail, memory_order_acquire);
+    uint64_t head = atomic_load_explicit(&ring->header->head, memory_order_relaxed);
+
+    for (;;) {
+        if (head == tail) {
+            return NULL;
+        }
+        uint32_t offset = (uint32_t)(head % capacity);
+        uint32_t len = *(uint32_t *)(ring->data + offset);
+        if (len == UINT32_MAX) {
+            head += capacity - offset;
+            atomic_store_explicit(&ring->header->head, head, memory_order_release);
+            continue;
+        }
+        /* The producer never writes a frame that crosses the end of the data
+         * area (it wraps with the UINT32_MAX marker instead), so any length
+         * past the remaining space is corruption. Drop the unreadable region
+         * rather than handing an out-of-range length to the consumer. */
+        if (len > capacity - offset - sizeof(uint32_t)) {
+            atomic_store_explicit(&ring->header->head, tail, memory_order_release);
+            return NULL;
+        }
+        *bson_len = len;
+        return ring->data + offset + sizeof(uint32_t);
+    }
+}
+
+/* Consumer side: retires the frame returned by trace_ring_front. */
+static void trace_ring_release(TraceRing *ring, uint32_t bson_len) {
+    uint64_t head = atomic_load_explicit(&ring->header->head, memory_order_relaxed);
+    atomic_store_explicit(&ring->header->head,
+                          head + TRACE_RING_ALIGN(sizeof(uint32_t) + bson_len),
+                          memory_order_release);
+}
+
+#endif /* TRACE_RING_BUFFER_H */
@@ -0,0 +1,183 @@
+#ifndef BINLOG_H
+#define BINLOG_H
+
+/*
+ * Shared logging module for the C tier. log_message() previously paid
+ * ctime() + fprintf + an unconditional fflush - a write syscall per trace on
+ * the ingest path. Here a log call copies a compact binary record into a
+ * lock-free per-thread ring; a background writer thread drains all rings to
+ * the log file. Records are {timestamp_ns:u64, thread_id:u32, level:u8,
+ * len:u8, msg bytes}; binlog_reader.c converts a file back to text.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BINLOG_MAX_THREADS 32
+#define BINLOG_RING_RECORDS 4096
+#define BINLOG_MSG_MAX 200
+
+#define BINLOG_LEVEL_INFO 0
+#define BINLOG_LEVEL_WARN 1
+#define BINLOG_LEVEL_ERROR 2
+
+typedef struct {
+    uint64_t ts_ns;
+    uint32_t tid;
+    uint8_t level;
+    uint8_t len;
+    char msg[BINLOG_MSG_MAX];
+} BinlogRecord;
+
+typedef struct {
+    BinlogRecord records[BINLOG_RING_RECORDS];
+    uint64_t head;
+    uint64_t tail;
+    int in_use;
+    uint32_t tid;
+} BinlogRing;
+
+static BinlogRing binlog_rings[BINLOG_MAX_THREADS];
+static FILE *binlog_file = NULL;
+static pthread_t binlog_writer;
+static int binlog_running = 0;
+static uint64_t binlog_dropped = 0;
+
+#if defined(__cplusplus)
+static thread_local int binlog_slot = -1;
+#else
+static _Thread_local int binlog_slot = -1;
+#endif
+
+static uint8_t binlog_level_from_string(const char *level) {
+    if (strcmp(level, "ERROR") == 0) return BINLOG_LEVEL_ERROR;
+    if (strcmp(level, "WARN") == 0) return BINLOG_LEVEL_WARN;
+    return BINLOG_LEVEL_INFO;
+}
+
+static const char* binlog_level_name(uint8_t level) {
+    switch (level) {
+        case BINLOG_LEVEL_ERROR: return "ERROR";
+        case BINLOG_LEVEL_WARN: return "WARN";
+        default: return "INFO";
+    }
+}
+
+static uint64_t binlog_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int binlog_ready(void) {
+    return binlog_running;
+}
+
+/* Hot path: one clock read, one record copy, one release store. Drops the
+ * record (and counts the drop) rather than blocking when the ring is full. */
+static void binlog_write(uint8_t level, const char *msg) {
+    if (!binlog_running) {
+        return;
+    }
+    if (binlog_slot < 0) {
+        for (int i = 0; i < BINLOG_MAX_THREADS; i++) {
+            int expected = 0;
+            if (__atomic_compare_exchange_n(&binlog_rings[i].in_use, &expected, 1, 0,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                binlog_rings[i].tid = (uint32_t)(uintptr_t)pthread_self();
+                binlog_slot = i;
+                break;
+            }
+        }
+        if (binlog_slot < 0) {
+            __atomic_fetch_add(&binlog_dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+
+    BinlogRing *ring = &binlog_rings[binlog_slot];
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint64_t tail = ring->tail;
+    if (tail - head >= BINLOG_RING_RECORDS) {
+        __atomic_fetch_add(&binlog_dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    BinlogRecord *record = &ring->records[tail % BINLOG_RING_RECORDS];
+    record->ts_ns = binlog_now_ns();
+    record->tid = ring->tid;
+    record->level = level;
+    size_t len = strlen(msg);
+    if (len > BINLOG_MSG_MAX) {
+        len = BINLOG_MSG_MAX;
+    }
+    record->len = (uint8_t)len;
+    memcpy(record->msg, msg, len);
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+static void* binlog_writer_main(void *arg) {
+    (void)arg;
+    while (1) {
+        int drained = 0;
+        for (int i = 0; i < BINLOG_MAX_THREADS; i++) {
+            BinlogRing *ring = &binlog_rings[i];
+            uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+            while (ring->head < tail) {
+                BinlogRecord *record = &ring->records[ring->head % BINLOG_RING_RECORDS];
+                fwrite(&record->ts_ns, sizeof(record->ts_ns), 1, binlog_file);
+                fwrite(&record->tid, sizeof(record->tid), 1, binlog_file);
+                fwrite(&record->level, sizeof(record->level), 1, binlog_file);
+                fwrite(&record->len, sizeof(record->len), 1, binlog_file);
+                fwrite(record->msg, 1, record->len, binlog_file);
+                __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+                drained++;
+            }
+        }
+        if (drained > 0) {
+            fflush(binlog_file);
+        } else if (!binlog_running) {
+            break;
+        } else {
+            usleep(1000);
+        }
+    }
+    return NULL;
+}
+
+static int binlog_init(const char *path) {
+    if (binlog_running) {
+        return 0;
+    }
+    binlog_file = fopen(path, "ab");
+    if (!binlog_file) {
+        return -1;
+    }
+    binlog_running = 1;
+    if (pthread_create(&binlog_writer, NULL, binlog_writer_main, NULL) != 0) {
+        binlog_running = 0;
+        fclose(binlog_file);
+        binlog_file = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static void binlog_shutdown(void) {
+    if (!binlog_running) {
+        return;
+    }
+    binlog_running = 0;
+    pthread_join(binlog_writer, NULL);
+    if (binlog_dropped > 0) {
+        fprintf(stderr, "binlog: dropped %llu records\n", (unsigned long long)binlog_dropped);
+    }
+    fclose(binlog_file);
+    binlog_file = NULL;
+}
+
+#endif /* BINLOG_H */
@@ -0,0 +1,53 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "binlog.h"
+
+/*
+ * Converter for the compact binary log format written through binlog.h:
+ * reads a .binlog file and prints one "[timestamp] [tid] LEVEL: msg" line
+ * per record, matching what the old text logs looked like.
+ *
+ * Usage: binlog_reader <file.binlog>
+ */
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <file.binlog>\n", argv[0]);
+        return 1;
+    }
+
+    FILE *input = fopen(argv[1], "rb");
+    if (!input) {
+        fprintf(stderr, "Failed to open %s\n", argv[1]);
+        return 1;
+    }
+
+    uint64_t ts_ns;
+    uint32_t tid;
+    uint8_t level;
+    uint8_t len;
+    char msg[BINLOG_MSG_MAX + 1];
+
+    while (fread(&ts_ns, sizeof(ts_ns), 1, input) == 1) {
+        if (fread(&tid, sizeof(tid), 1, input) != 1 ||
+            fread(&level, sizeof(level), 1, input) != 1 ||
+            fread(&len, sizeof(len), 1, input) != 1 ||
+            fread(msg, 1, len, input) != len) {
+            fprintf(stderr, "Truncated record\n");
+            break;
+        }
+        msg[len] = '\0';
+
+        time_t seconds = (time_t)(ts_ns / 1000000000ull);
+        struct tm tm_buf;
+        char when[32];
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime_r(&seconds, &tm_buf));
+        printf("[%s.%09llu] [%u] %s: %s\n", when,
+               (unsigned long long)(ts_ns % 1000000000ull), tid, binlog_level_name(level), msg);
+    }
+
+    fclose(input);
+    return 0;
+}
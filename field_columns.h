@@ -0,0 +1,214 @@
+#ifndef FIELD_COLUMNS_H
+#define FIELD_COLUMNS_H
+
+/*
+ * Columnar field-profile sidecar for the traces dataset. The dispatcher
+ * records one (field name, BSON type) observation per field at ingest into a
+ * fixed in-memory table of per-field type bitmaps and counts, and flushes it
+ * periodically to a compact binary file. The fixer's field profiling then
+ * reads a few hundred KB of column metadata sequentially instead of running
+ * $objectToArray + $unwind over every raw document. Flushing merges into
+ * whatever an earlier run wrote, so the file stays compacted by construction.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define FIELD_COLUMNS_FILE "trades_fields.col"
+#define FIELD_COLUMNS_MAGIC 0x434f4c31u /* "COL1" */
+#define FIELD_COLUMNS_MAX 256
+#define FIELD_COLUMNS_NAME_MAX 96
+
+/* Type bits cover the BSON types traces actually carry; everything else
+ * collapses into OTHER, which the fixer already treats as mixed data. */
+#define FIELD_TYPE_DOUBLE (1u << 0)
+#define FIELD_TYPE_STRING (1u << 1)
+#define FIELD_TYPE_OBJECT (1u << 2)
+#define FIELD_TYPE_ARRAY (1u << 3)
+#define FIELD_TYPE_BOOL (1u << 4)
+#define FIELD_TYPE_DATE (1u << 5)
+#define FIELD_TYPE_NULL (1u << 6)
+#define FIELD_TYPE_INT32 (1u << 7)
+#define FIELD_TYPE_INT64 (1u << 8)
+#define FIELD_TYPE_OTHER (1u << 9)
+#define FIELD_TYPE_BITS 10
+
+typedef struct {
+    char name[FIELD_COLUMNS_NAME_MAX];
+    uint32_t type_bitmap;
+    uint64_t count;
+    int used;
+} FieldColumn;
+
+static FieldColumn field_columns[FIELD_COLUMNS_MAX];
+static pthread_mutex_t field_columns_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Maps a raw BSON type code (bson_type_t / bsoncxx::type) to its bit. */
+static uint32_t field_columns_type_bit(int bson_type) {
+    switch (bson_type) {
+        case 0x01: return FIELD_TYPE_DOUBLE;
+        case 0x02: return FIELD_TYPE_STRING;
+        case 0x03: return FIELD_TYPE_OBJECT;
+        case 0x04: return FIELD_TYPE_ARRAY;
+        case 0x08: return FIELD_TYPE_BOOL;
+        case 0x09: return FIELD_TYPE_DATE;
+        case 0x0A: return FIELD_TYPE_NULL;
+        case 0x10: return FIELD_TYPE_INT32;
+        case 0x12: return FIELD_TYPE_INT64;
+        default: return FIELD_TYPE_OTHER;
+    }
+}
+
+/* Type names match $type's aliases as reported by the $objectToArray
+ * profiling pipeline, so the fixer's downstream checks keep working
+ * unchanged. The recorder keeps the key set aligned too: it observes
+ * top-level fields only, exactly what $objectToArray on $$ROOT sees. */
+static const char* field_columns_type_name(uint32_t bit) {
+    switch (bit) {
+        case FIELD_TYPE_DOUBLE: return "double";
+        case FIELD_TYPE_STRING: return "string";
+        case FIELD_TYPE_OBJECT: return "object";
+        case FIELD_TYPE_ARRAY: return "array";
+        case FIELD_TYPE_BOOL: return "bool";
+        case FIELD_TYPE_DATE: return "date";
+        case FIELD_TYPE_NULL: return "null";
+        case FIELD_TYPE_INT32: return "int";
+        case FIELD_TYPE_INT64: return "long";
+        default: return "other";
+    }
+}
+
+static uint32_t field_columns_hash(const char *name) {
+    uint32_t hash = 2166136261u;
+    for (const char *p = name; *p; p++) {
+        hash = (hash ^ (uint32_t)*p) * 16777619u;
+    }
+    return hash;
+}
+
+/* Open-addressed slot lookup. Names are written once under the mutex and
+ * published with a release store of `used`, so the common hit path is a
+ * lock-free probe. Returns -1 when the table is full. */
+static int field_columns_slot(const char *name) {
+    uint32_t slot = field_columns_hash(name) % FIELD_COLUMNS_MAX;
+    for (int probes = 0; probes < FIELD_COLUMNS_MAX; probes++) {
+        FieldColumn *column = &field_columns[slot];
+        if (__atomic_load_n(&column->used, __ATOMIC_ACQUIRE)) {
+            if (strcmp(column->name, name) == 0) {
+                return (int)slot;
+            }
+        } else {
+            pthread_mutex_lock(&field_columns_mutex);
+            if (!column->used) {
+                strncpy(column->name, name, FIELD_COLUMNS_NAME_MAX - 1);
+                column->name[FIELD_COLUMNS_NAME_MAX - 1] = '\0';
+                __atomic_store_n(&column->used, 1, __ATOMIC_RELEASE);
+                pthread_mutex_unlock(&field_columns_mutex);
+                return (int)slot;
+            }
+            pthread_mutex_unlock(&field_columns_mutex);
+            if (strcmp(column->name, name) == 0) {
+                return (int)slot;
+            }
+        }
+        slot = (slot + 1) % FIELD_COLUMNS_MAX;
+    }
+    return -1;
+}
+
+/* Ingest hot path: one probe, one atomic OR, one atomic add. */
+static void field_columns_record(const char *name, int bson_type) {
+    int slot = field_columns_slot(name);
+    if (slot < 0) {
+        return;
+    }
+    __atomic_fetch_or(&field_columns[slot].type_bitmap, field_columns_type_bit(bson_type), __ATOMIC_RELAXED);
+    __atomic_fetch_add(&field_columns[slot].count, 1, __ATOMIC_RELAXED);
+}
+
+static void field_columns_record_n(const char *name, int bson_type, uint64_t count) {
+    int slot = field_columns_slot(name);
+    if (slot < 0) {
+        return;
+    }
+    __atomic_fetch_or(&field_columns[slot].type_bitmap, field_columns_type_bit(bson_type), __ATOMIC_RELAXED);
+    __atomic_fetch_add(&field_columns[slot].count, count, __ATOMIC_RELAXED);
+}
+
+/* Merges an existing sidecar into the in-memory table. Returns the number
+ * of columns loaded, or -1 when the file is missing or malformed. */
+static int field_columns_load(const char *path) {
+    FILE *input = fopen(path, "rb");
+    if (!input) {
+        return -1;
+    }
+
+    uint32_t magic = 0;
+    uint32_t count = 0;
+    if (fread(&magic, sizeof(magic), 1, input) != 1 || magic != FIELD_COLUMNS_MAGIC ||
+        fread(&count, sizeof(count), 1, input) != 1 || count > FIELD_COLUMNS_MAX) {
+        fclose(input);
+        return -1;
+    }
+
+    int loaded = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        char name[FIELD_COLUMNS_NAME_MAX];
+        uint32_t bitmap = 0;
+        uint64_t field_count = 0;
+        if (fread(name, 1, FIELD_COLUMNS_NAME_MAX, input) != FIELD_COLUMNS_NAME_MAX ||
+            fread(&bitmap, sizeof(bitmap), 1, input) != 1 ||
+            fread(&field_count, sizeof(field_count), 1, input) != 1) {
+            break;
+        }
+        name[FIELD_COLUMNS_NAME_MAX - 1] = '\0';
+        int slot = field_columns_slot(name);
+        if (slot < 0) {
+            continue;
+        }
+        __atomic_fetch_or(&field_columns[slot].type_bitmap, bitmap, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&field_columns[slot].count, field_count, __ATOMIC_RELAXED);
+        loaded++;
+    }
+
+    fclose(input);
+    return loaded;
+}
+
+/* Rewrites the sidecar from the in-memory table: one pass, already merged,
+ * so the file never needs a separate compaction job. Returns 0 on success. */
+static int field_columns_flush(const char *path) {
+    FILE *output = fopen(path, "wb");
+    if (!output) {
+        return -1;
+    }
+
+    uint32_t count = 0;
+    for (int i = 0; i < FIELD_COLUMNS_MAX; i++) {
+        if (__atomic_load_n(&field_columns[i].used, __ATOMIC_ACQUIRE)) {
+            count++;
+        }
+    }
+
+    uint32_t magic = FIELD_COLUMNS_MAGIC;
+    fwrite(&magic, sizeof(magic), 1, output);
+    fwrite(&count, sizeof(count), 1, output);
+    for (int i = 0; i < FIELD_COLUMNS_MAX; i++) {
+        FieldColumn *column = &field_columns[i];
+        if (!__atomic_load_n(&column->used, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+        uint32_t bitmap = __atomic_load_n(&column->type_bitmap, __ATOMIC_RELAXED);
+        uint64_t field_count = __atomic_load_n(&column->count, __ATOMIC_RELAXED);
+        fwrite(column->name, 1, FIELD_COLUMNS_NAME_MAX, output);
+        fwrite(&bitmap, sizeof(bitmap), 1, output);
+        fwrite(&field_count, sizeof(field_count), 1, output);
+    }
+
+    fclose(output);
+    return 0;
+}
+
+#endif /* FIELD_COLUMNS_H */
@@ -0,0 +1,135 @@
+#ifndef PERF_METRICS_H
+#define PERF_METRICS_H
+
+/*
+ * Header-only latency instrumentation for the hot paths (dispatch_trace,
+ * validate_requirements, take_action_on_shape_change, the fixer
+ * aggregations). Records go into power-of-two latency buckets (HDR style)
+ * via relaxed atomic adds; counts and sums are batched in thread-local
+ * pending slots and folded in every PERF_FLUSH_EVERY records, so the cost on
+ * the hot path is a clock read and a handful of uncontended increments.
+ * perf_dump() aggregates lock-free and emits Prometheus text format.
+ *
+ * Usage:
+ *   static int site = -1;
+ *   if (site < 0) site = perf_register("dispatch_trace");
+ *   uint64_t start = perf_now_ns();
+ *   ... work ...
+ *   perf_record(site, start);
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#define PERF_MAX_SITES 16
+#define PERF_BUCKETS 64
+#define PERF_FLUSH_EVERY 256
+
+#if defined(__cplusplus)
+#define PERF_THREAD_LOCAL thread_local
+#else
+#define PERF_THREAD_LOCAL _Thread_local
+#endif
+
+typedef struct {
+    const char *name;
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t buckets[PERF_BUCKETS];
+} PerfHistogram;
+
+static PerfHistogram perf_sites[PERF_MAX_SITES];
+static int perf_site_count = 0;
+
+static PERF_THREAD_LOCAL uint64_t perf_pending_count[PERF_MAX_SITES];
+static PERF_THREAD_LOCAL uint64_t perf_pending_ns[PERF_MAX_SITES];
+
+static int perf_register(const char *name) {
+    int idx = __atomic_fetch_add(&perf_site_count, 1, __ATOMIC_RELAXED);
+    if (idx >= PERF_MAX_SITES) {
+        return -1;
+    }
+    perf_sites[idx].name = name;
+    return idx;
+}
+
+static uint64_t perf_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void perf_record(int site, uint64_t start_ns) {
+    if (site < 0 || site >= PERF_MAX_SITES) {
+        return;
+    }
+    uint64_t elapsed = perf_now_ns() - start_ns;
+
+    int bucket = 0;
+    uint64_t bound = 1;
+    while (bucket < PERF_BUCKETS - 1 && bound < elapsed) {
+        bound <<= 1;
+        bucket++;
+    }
+    __atomic_fetch_add(&perf_sites[site].buckets[bucket], 1, __ATOMIC_RELAXED);
+
+    perf_pending_count[site]++;
+    perf_pending_ns[site] += elapsed;
+    if (perf_pending_count[site] >= PERF_FLUSH_EVERY) {
+        __atomic_fetch_add(&perf_sites[site].count, perf_pending_count[site], __ATOMIC_RELAXED);
+        __atomic_fetch_add(&perf_sites[site].total_ns, perf_pending_ns[site], __ATOMIC_RELAXED);
+        perf_pending_count[site] = 0;
+        perf_pending_ns[site] = 0;
+    }
+}
+
+/* Folds this thread's pending slots into the shared histograms. Call before
+ * scraping from a thread that recorded fewer than PERF_FLUSH_EVERY samples. */
+static void perf_flush_thread(void) {
+    int sites = perf_site_count < PERF_MAX_SITES ? perf_site_count : PERF_MAX_SITES;
+    for (int site = 0; site < sites; site++) {
+        if (perf_pending_count[site] > 0) {
+            __atomic_fetch_add(&perf_sites[site].count, perf_pending_count[site], __ATOMIC_RELAXED);
+            __atomic_fetch_add(&perf_sites[site].total_ns, perf_pending_ns[site], __ATOMIC_RELAXED);
+            perf_pending_count[site] = 0;
+            perf_pending_ns[site] = 0;
+        }
+    }
+}
+
+/* Prometheus text exposition of every registered site. */
+static void perf_dump(FILE *out) {
+    int sites = perf_site_count < PERF_MAX_SITES ? perf_site_count : PERF_MAX_SITES;
+    for (int site = 0; site < sites; site++) {
+        PerfHistogram *hist = &perf_sites[site];
+        uint64_t cumulative = 0;
+        uint64_t bound = 1;
+        for (int bucket = 0; bucket < PERF_BUCKETS; bucket++) {
+            uint64_t samples = __atomic_load_n(&hist->buckets[bucket], __ATOMIC_RELAXED);
+            cumulative += samples;
+            if (samples > 0) {
+                fprintf(out, "zero0x_latency_ns_bucket{site=\"%s\",le=\"%llu\"} %llu\n",
+                        hist->name, (unsigned long long)bound, (unsigned long long)cumulative);
+            }
+            bound <<= 1;
+        }
+        fprintf(out, "zero0x_latency_ns_count{site=\"%s\"} %llu\n",
+                hist->name, (unsigned long long)__atomic_load_n(&hist->count, __ATOMIC_RELAXED));
+        fprintf(out, "zero0x_latency_ns_sum{site=\"%s\"} %llu\n",
+                hist->name, (unsigned long long)__atomic_load_n(&hist->total_ns, __ATOMIC_RELAXED));
+    }
+}
+
+static int perf_dump_to_file(const char *path) {
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        return -1;
+    }
+    perf_flush_thread();
+    perf_dump(out);
+    fclose(out);
+    return 0;
+}
+
+#endif /* PERF_METRICS_H */
@@ -1,22 +1,33 @@
 #include <mongoc/mongoc.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <json-c/json.h>
 
+#include "binlog.h"
+
 #define MONGO_URI "mongodb://localhost:27017"
 #define DB_NAME "zero0x_db"
 #define COLLECTION_NAME "query_logs"
-#define OUTPUT_FILE "query_usage_doc.json"
+#define INDEX_COLLECTION_NAME "query_usage_index"
+#define OUTPUT_FILE_FMT "query_usage_%s.json"
+#define USAGE_WORKERS 16
+#define MAX_ORGS 4096
+#define ORG_ID_MAX 64
+#define INDEX_BULK_CHUNK 1000
 
 typedef struct {
-    mongoc_client_t *client;
-    mongoc_collection_t *collection;
+    mongoc_client_pool_t *pool;
     FILE *log_file;
 } QueryUsageDoc;
 
 void log_message(QueryUsageDoc *doc, const char *level, const char *msg) {
+    if (binlog_ready()) {
+        binlog_write(binlog_level_from_string(level), msg);
+        return;
+    }
     time_t now = time(NULL);
     fprintf(doc->log_file, "[%s] %s: %s\n", ctime(&now), level, msg);
     fflush(doc->log_file);
@@ -34,78 +45,437 @@ QueryUsageDoc* init_query_usage_doc() {
         free(doc);
         return NULL;
     }
+    binlog_init("query_usage_doc.binlog");
 
     mongoc_init();
-    doc->client = mongoc_client_new(MONGO_URI);
-    if (!doc->client) {
-        log_message(doc, "ERROR", "MongoDB client init failed");
+    mongoc_uri_t *uri = mongoc_uri_new(MONGO_URI);
+    doc->pool = uri ? mongoc_client_pool_new(uri) : NULL;
+    mongoc_uri_destroy(uri);
+    if (!doc->pool) {
+        log_message(doc, "ERROR", "MongoDB client pool init failed");
         fclose(doc->log_file);
         free(doc);
         mongoc_cleanup();
         return NULL;
     }
 
-    doc->collection = mongoc_client_get_collection(doc->client, DB_NAME, COLLECTION_NAME);
     log_message(doc, "INFO", "Query usage doc initialized");
     return doc;
 }
 
-int generate_usage_doc(QueryUsageDoc *doc, const char *org_id) {
-    bson_t *query = BCON_NEW("org_id", BCON_UTF8(org_id));
-    mongoc_cursor_t *cursor = mongoc_collection_find_with_opts(doc->collection, query, NULL, NULL);
+// FNV-1a over the query text; the hex digest keys the persisted
+// query_usage_index collection.
+static void query_fingerprint(const char *query_text, char out[17]) {
+    uint64_t hash = 1469598103934665603ull;
+    for (const char *p = query_text; *p; p++) {
+        hash = (hash ^ (uint64_t)*p) * 1099511628211ull;
+    }
+    snprintf(out, 17, "%016llx", (unsigned long long)hash);
+}
+
+// Per-org high-water mark over query_logs _ids, stored alongside the index
+// entries under "watermark:<org>". Rows at or below the mark are already
+// folded into the index, so a run never $inc's the same row twice.
+static int load_index_watermark(mongoc_collection_t *index_collection, const char *org_id, bson_oid_t *last_id) {
+    char key[ORG_ID_MAX + 16];
+    snprintf(key, sizeof(key), "watermark:%s", org_id);
+    bson_t *query = BCON_NEW("_id", BCON_UTF8(key));
+    mongoc_cursor_t *cursor = mongoc_collection_find_with_opts(index_collection, query, NULL, NULL);
+
+    int found = 0;
+    const bson_t *bson_doc;
+    if (mongoc_cursor_next(cursor, &bson_doc)) {
+        bson_iter_t iter;
+        if (bson_iter_init_find(&iter, bson_doc, "last_id") && BSON_ITER_HOLDS_OID(&iter)) {
+            bson_oid_copy(bson_iter_oid(&iter), last_id);
+            found = 1;
+        }
+    }
+    mongoc_cursor_destroy(cursor);
+    bson_destroy(query);
+    return found;
+}
+
+static void save_index_watermark(QueryUsageDoc *doc, mongoc_collection_t *index_collection, const char *org_id, const bson_oid_t *last_id) {
+    char key[ORG_ID_MAX + 16];
+    snprintf(key, sizeof(key), "watermark:%s", org_id);
+    bson_t *selector = BCON_NEW("_id", BCON_UTF8(key));
+    bson_t *update = BCON_NEW("$set", "{", "last_id", BCON_OID(last_id), "}");
+    bson_t *opts = BCON_NEW("upsert", BCON_BOOL(true));
     bson_error_t error;
+    if (!mongoc_collection_update_one(index_collection, selector, update, opts, NULL, &error)) {
+        log_message(doc, "ERROR", error.message);
+    }
+    bson_destroy(opts);
+    bson_destroy(update);
+    bson_destroy(selector);
+}
 
-    struct json_object *doc_json = json_object_new_object();
-    struct json_object *queries = json_object_new_array();
-    double total_gb_hours = 0.0;
+int generate_usage_doc_from_index(QueryUsageDoc *doc, const char *org_id, int top_n);
+
+// Folds query_logs rows newer than the org's watermark into the
+// query_usage_index collection ($inc per fingerprint, executed in chunks of
+// INDEX_BULK_CHUNK so memory stays bounded), advances the watermark, then
+// serves the report as a point read on the index. The first run for an org
+// scans its full history; every later run scans only the delta since the
+// previous one, so totals stay exact and the nightly pass stops re-reading
+// 14M-row orgs end to end. Clients come from the shared pool, so the
+// function is safe to call from several workers at once.
+int generate_usage_doc(QueryUsageDoc *doc, const char *org_id, int top_n) {
+    mongoc_client_t *client = mongoc_client_pool_pop(doc->pool);
+    mongoc_collection_t *collection = mongoc_client_get_collection(client, DB_NAME, COLLECTION_NAME);
+    mongoc_collection_t *index_collection = mongoc_client_get_collection(client, DB_NAME, INDEX_COLLECTION_NAME);
+
+    bson_oid_t watermark;
+    bson_t *query;
+    if (load_index_watermark(index_collection, org_id, &watermark)) {
+        query = BCON_NEW("org_id", BCON_UTF8(org_id), "_id", "{", "$gt", BCON_OID(&watermark), "}");
+    } else {
+        query = BCON_NEW("org_id", BCON_UTF8(org_id));
+    }
+    bson_t *opts = BCON_NEW("sort", "{", "_id", BCON_INT32(1), "}");
+    mongoc_cursor_t *cursor = mongoc_collection_find_with_opts(collection, query, opts, NULL);
+
+    mongoc_bulk_operation_t *index_bulk = mongoc_collection_create_bulk_operation_with_opts(index_collection, NULL);
+    bson_t *upsert_opts = BCON_NEW("upsert", BCON_BOOL(true));
+    bson_oid_t last_id;
+    long rows = 0;
+    int queued = 0;
 
     const bson_t *bson_doc;
     while (mongoc_cursor_next(cursor, &bson_doc)) {
         bson_iter_t iter;
-        if (bson_iter_init_find(&iter, bson_doc, "duration_ms") && bson_iter_init_find(&iter, bson_doc, "memory_mb")) {
-            double duration_ms = bson_iter_double(&iter);
-            double memory_mb = bson_iter_double(&iter);
-            double gb_hours = (memory_mb / 1024.0) * (duration_ms / (1000.0 * 3600.0));
-            total_gb_hours += gb_hours;
+        double duration_ms = 0.0;
+        double memory_mb = 0.0;
+        const char *query_text = "";
+        if (bson_iter_init_find(&iter, bson_doc, "duration_ms")) {
+            duration_ms = bson_iter_double(&iter);
+        }
+        if (bson_iter_init_find(&iter, bson_doc, "memory_mb")) {
+            memory_mb = bson_iter_double(&iter);
+        }
+        if (bson_iter_init_find(&iter, bson_doc, "query_text")) {
+            query_text = bson_iter_utf8(&iter, NULL);
+        }
+        if (bson_iter_init_find(&iter, bson_doc, "_id") && BSON_ITER_HOLDS_OID(&iter)) {
+            bson_oid_copy(bson_iter_oid(&iter), &last_id);
+        }
 
-            struct json_object *query_entry = json_object_new_object();
-            json_object_object_add(query_entry, "query_text", json_object_new_string(bson_iter_find(&iter, "query_text") ? bson_iter_utf8(&iter, NULL) : ""));
-            json_object_object_add(query_entry, "gb_hours", json_object_new_double(gb_hours));
-            json_object_array_add(queries, query_entry);
+        double gb_hours = (memory_mb / 1024.0) * (duration_ms / (1000.0 * 3600.0));
+
+        char fingerprint[17];
+        query_fingerprint(query_text, fingerprint);
+        bson_t *selector = BCON_NEW("org_id", BCON_UTF8(org_id), "fingerprint", BCON_UTF8(fingerprint));
+        bson_t *update = BCON_NEW(
+            "$inc", "{", "gb_hours", BCON_DOUBLE(gb_hours), "}",
+            "$setOnInsert", "{", "query_text", BCON_UTF8(query_text), "}");
+        mongoc_bulk_operation_update_one_with_opts(index_bulk, selector, update, upsert_opts, NULL);
+        bson_destroy(update);
+        bson_destroy(selector);
+        rows++;
+
+        if (++queued >= INDEX_BULK_CHUNK) {
+            bson_error_t error;
+            bson_t reply;
+            if (!mongoc_bulk_operation_execute(index_bulk, &reply, &error)) {
+                log_message(doc, "ERROR", error.message);
+            }
+            bson_destroy(&reply);
+            mongoc_bulk_operation_destroy(index_bulk);
+            index_bulk = mongoc_collection_create_bulk_operation_with_opts(index_collection, NULL);
+            queued = 0;
         }
     }
 
-    json_object_object_add(doc_json, "org_id", json_object_new_string(org_id));
-    json_object_object_add(doc_json, "total_gb_hours", json_object_new_double(total_gb_hours));
-    json_object_object_add(doc_json, "optimization_tip", json_object_new_string("Use field-specific filters first to reduce GB-hours"));
-    json_object_object_add(doc_json, "queries", queries);
+    if (queued > 0) {
+        bson_error_t error;
+        bson_t reply;
+        if (!mongoc_bulk_operation_execute(index_bulk, &reply, &error)) {
+            log_message(doc, "ERROR", error.message);
+        }
+        bson_destroy(&reply);
+    }
+    bson_destroy(upsert_opts);
+    mongoc_bulk_operation_destroy(index_bulk);
 
-    FILE *output = fopen(OUTPUT_FILE, "w");
+    // The cursor is _id-sorted, so last_id is the highest row folded in.
+    if (rows > 0) {
+        save_index_watermark(doc, index_collection, org_id, &last_id);
+    }
+
+    mongoc_cursor_destroy(cursor);
+    bson_destroy(opts);
+    bson_destroy(query);
+    mongoc_collection_destroy(index_collection);
+    mongoc_collection_destroy(collection);
+    mongoc_client_pool_push(doc->pool, client);
+
+    return generate_usage_doc_from_index(doc, org_id, top_n);
+}
+
+// Point-read mode: once the fingerprint index has been maintained, the
+// top-N report is a sorted, limited find on query_usage_index plus one
+// $group for the org total - no scan of raw query_logs at all.
+int generate_usage_doc_from_index(QueryUsageDoc *doc, const char *org_id, int top_n) {
+    mongoc_client_t *client = mongoc_client_pool_pop(doc->pool);
+    mongoc_collection_t *index_collection = mongoc_client_get_collection(client, DB_NAME, INDEX_COLLECTION_NAME);
+
+    bson_t *query = BCON_NEW("org_id", BCON_UTF8(org_id));
+    bson_t *opts = BCON_NEW(
+        "sort", "{", "gb_hours", BCON_INT32(-1), "}",
+        "limit", BCON_INT64(top_n));
+    mongoc_cursor_t *cursor = mongoc_collection_find_with_opts(index_collection, query, opts, NULL);
+
+    char output_path[ORG_ID_MAX + 32];
+    snprintf(output_path, sizeof(output_path), OUTPUT_FILE_FMT, org_id);
+    FILE *output = fopen(output_path, "w");
     if (!output) {
         log_message(doc, "ERROR", "Failed to open output file");
-        json_object_put(doc_json);
         mongoc_cursor_destroy(cursor);
+        bson_destroy(opts);
         bson_destroy(query);
+        mongoc_collection_destroy(index_collection);
+        mongoc_client_pool_push(doc->pool, client);
         return -1;
     }
-    fprintf(output, "%s\n", json_object_to_json_string_ext(doc_json, JSON_C_TO_STRING_PRETTY));
+
+    long entries = 0;
+    fprintf(output, "{\n  \"org_id\": \"%s\",\n  \"queries\": [", org_id);
+
+    const bson_t *bson_doc;
+    while (mongoc_cursor_next(cursor, &bson_doc)) {
+        bson_iter_t iter;
+        const char *query_text = "";
+        double gb_hours = 0.0;
+        if (bson_iter_init_find(&iter, bson_doc, "query_text")) {
+            query_text = bson_iter_utf8(&iter, NULL);
+        }
+        if (bson_iter_init_find(&iter, bson_doc, "gb_hours")) {
+            gb_hours = bson_iter_double(&iter);
+        }
+        struct json_object *query_entry = json_object_new_object();
+        json_object_object_add(query_entry, "query_text", json_object_new_string(query_text));
+        json_object_object_add(query_entry, "gb_hours", json_object_new_double(gb_hours));
+        fprintf(output, "%s\n    %s", entries > 0 ? "," : "", json_object_to_json_string(query_entry));
+        json_object_put(query_entry);
+        entries++;
+    }
+
+    double total_gb_hours = 0.0;
+    bson_t *pipeline = BCON_NEW(
+        "pipeline", "[",
+            "{", "$match", "{", "org_id", BCON_UTF8(org_id), "}", "}",
+            "{", "$group", "{",
+                "_id", BCON_NULL,
+                "total_gb_hours", "{", "$sum", BCON_UTF8("$gb_hours"), "}",
+            "}", "}",
+        "]");
+    mongoc_cursor_t *total_cursor = mongoc_collection_aggregate(index_collection, MONGOC_QUERY_NONE, pipeline, NULL, NULL);
+    const bson_t *total_doc;
+    if (mongoc_cursor_next(total_cursor, &total_doc)) {
+        bson_iter_t iter;
+        if (bson_iter_init_find(&iter, total_doc, "total_gb_hours")) {
+            total_gb_hours = bson_iter_double(&iter);
+        }
+    }
+    mongoc_cursor_destroy(total_cursor);
+    bson_destroy(pipeline);
+
+    fprintf(output, "\n  ],\n  \"total_gb_hours\": %f,\n", total_gb_hours);
+    fprintf(output, "  \"optimization_tip\": \"Use field-specific filters first to reduce GB-hours\"\n}\n");
     fclose(output);
 
-    log_message(doc, "INFO", "Query usage documentation generated");
-    json_object_put(doc_json);
+    log_message(doc, "INFO", "Query usage documentation generated (index point read)");
     mongoc_cursor_destroy(cursor);
+    bson_destroy(opts);
     bson_destroy(query);
+    mongoc_collection_destroy(index_collection);
+    mongoc_client_pool_push(doc->pool, client);
+    return 0;
+}
+
+// Aggregation-pipeline mode: the GB-hours multiplication, the per-org total,
+// and the top-N selection all run inside MongoDB, so the client receives a
+// few kilobytes instead of every raw query_logs row for the org.
+int generate_usage_doc_aggregated(QueryUsageDoc *doc, const char *org_id, int top_n) {
+    mongoc_client_t *client = mongoc_client_pool_pop(doc->pool);
+    mongoc_collection_t *collection = mongoc_client_get_collection(client, DB_NAME, COLLECTION_NAME);
+    bson_t *pipeline = BCON_NEW(
+        "pipeline", "[",
+            "{", "$match", "{", "org_id", BCON_UTF8(org_id), "}", "}",
+            "{", "$project", "{",
+                "query_text", BCON_INT32(1),
+                "gb_hours", "{", "$multiply", "[",
+                    "{", "$divide", "[", "$memory_mb", BCON_DOUBLE(1024.0), "]", "}",
+                    "{", "$divide", "[", "$duration_ms", BCON_DOUBLE(3600000.0), "]", "}",
+                "]", "}",
+            "}", "}",
+            "{", "$sort", "{", "gb_hours", BCON_INT32(-1), "}", "}",
+            "{", "$facet", "{",
+                "top_queries", "[", "{", "$limit", BCON_INT32(top_n), "}", "]",
+                "totals", "[", "{", "$group", "{",
+                    "_id", BCON_NULL,
+                    "total_gb_hours", "{", "$sum", BCON_UTF8("$gb_hours"), "}",
+                "}", "}", "]",
+            "}", "}",
+        "]");
+    mongoc_cursor_t *cursor = mongoc_collection_aggregate(collection, MONGOC_QUERY_NONE, pipeline, NULL, NULL);
+
+    char output_path[ORG_ID_MAX + 32];
+    snprintf(output_path, sizeof(output_path), OUTPUT_FILE_FMT, org_id);
+    FILE *output = fopen(output_path, "w");
+    if (!output) {
+        log_message(doc, "ERROR", "Failed to open output file");
+        mongoc_cursor_destroy(cursor);
+        bson_destroy(pipeline);
+        mongoc_collection_destroy(collection);
+        mongoc_client_pool_push(doc->pool, client);
+        return -1;
+    }
+
+    double total_gb_hours = 0.0;
+    long entries = 0;
+    fprintf(output, "{\n  \"org_id\": \"%s\",\n  \"queries\": [", org_id);
+
+    const bson_t *result;
+    while (mongoc_cursor_next(cursor, &result)) {
+        bson_iter_t iter;
+        bson_iter_t facet;
+        if (bson_iter_init_find(&iter, result, "top_queries") && bson_iter_recurse(&iter, &facet)) {
+            while (bson_iter_next(&facet)) {
+                bson_iter_t fields;
+                const char *query_text = "";
+                double gb_hours = 0.0;
+                bson_iter_recurse(&facet, &fields);
+                while (bson_iter_next(&fields)) {
+                    if (strcmp(bson_iter_key(&fields), "query_text") == 0) {
+                        query_text = bson_iter_utf8(&fields, NULL);
+                    } else if (strcmp(bson_iter_key(&fields), "gb_hours") == 0) {
+                        gb_hours = bson_iter_double(&fields);
+                    }
+                }
+                struct json_object *query_entry = json_object_new_object();
+                json_object_object_add(query_entry, "query_text", json_object_new_string(query_text));
+                json_object_object_add(query_entry, "gb_hours", json_object_new_double(gb_hours));
+                fprintf(output, "%s\n    %s", entries > 0 ? "," : "", json_object_to_json_string(query_entry));
+                json_object_put(query_entry);
+                entries++;
+            }
+        }
+        if (bson_iter_init_find(&iter, result, "totals") && bson_iter_recurse(&iter, &facet) && bson_iter_next(&facet)) {
+            bson_iter_t fields;
+            bson_iter_recurse(&facet, &fields);
+            while (bson_iter_next(&fields)) {
+                if (strcmp(bson_iter_key(&fields), "total_gb_hours") == 0) {
+                    total_gb_hours = bson_iter_double(&fields);
+                }
+            }
+        }
+    }
+
+    fprintf(output, "\n  ],\n  \"total_gb_hours\": %f,\n", total_gb_hours);
+    fprintf(output, "  \"optimization_tip\": \"Use field-specific filters first to reduce GB-hours\"\n}\n");
+    fclose(output);
+
+    log_message(doc, "INFO", "Query usage documentation generated (server-side aggregation)");
+    mongoc_cursor_destroy(cursor);
+    bson_destroy(pipeline);
+    mongoc_collection_destroy(collection);
+    mongoc_client_pool_push(doc->pool, client);
     return 0;
 }
 
+// Multi-org mode: one process, one client pool, USAGE_WORKERS threads. Each
+// worker claims org indexes from a shared atomic counter and writes that
+// org's report with the incremental path — folding the delta since the
+// last run into the fingerprint index, then point-reading the report from
+// it — replacing the nightly shell loop that paid process startup and
+// connection setup 3,100 times.
+typedef struct {
+    QueryUsageDoc *doc;
+    char (*org_ids)[ORG_ID_MAX];
+    int org_count;
+    int next_org;
+    int failures;
+    int top_n;
+} UsageJob;
+
+static void* usage_worker(void *arg) {
+    UsageJob *job = (UsageJob*)arg;
+    while (1) {
+        int idx = __atomic_fetch_add(&job->next_org, 1, __ATOMIC_RELAXED);
+        if (idx >= job->org_count) {
+            break;
+        }
+        if (generate_usage_doc(job->doc, job->org_ids[idx], job->top_n) != 0) {
+            __atomic_fetch_add(&job->failures, 1, __ATOMIC_RELAXED);
+        }
+    }
+    return NULL;
+}
+
+// Fills org_ids with the distinct org_id values in query_logs. Returns the
+// org count, or -1 on command failure.
+int discover_org_ids(QueryUsageDoc *doc, char (*org_ids)[ORG_ID_MAX], int max_orgs) {
+    mongoc_client_t *client = mongoc_client_pool_pop(doc->pool);
+    bson_t *command = BCON_NEW("distinct", BCON_UTF8(COLLECTION_NAME), "key", BCON_UTF8("org_id"));
+    bson_t reply;
+    bson_error_t error;
+    int count = -1;
+
+    if (mongoc_client_command_simple(client, DB_NAME, command, NULL, &reply, &error)) {
+        count = 0;
+        bson_iter_t iter;
+        bson_iter_t values;
+        if (bson_iter_init_find(&iter, &reply, "values") && bson_iter_recurse(&iter, &values)) {
+            while (bson_iter_next(&values) && count < max_orgs) {
+                if (BSON_ITER_HOLDS_UTF8(&values)) {
+                    bson_strncpy(org_ids[count++], bson_iter_utf8(&values, NULL), ORG_ID_MAX);
+                }
+            }
+        }
+    } else {
+        log_message(doc, "ERROR", error.message);
+    }
+
+    bson_destroy(&reply);
+    bson_destroy(command);
+    mongoc_client_pool_push(doc->pool, client);
+    return count;
+}
+
+int generate_usage_docs_parallel(QueryUsageDoc *doc, char (*org_ids)[ORG_ID_MAX], int org_count, int top_n) {
+    UsageJob job = {doc, org_ids, org_count, 0, 0, top_n};
+    pthread_t workers[USAGE_WORKERS];
+    int started = 0;
+
+    for (int i = 0; i < USAGE_WORKERS && i < org_count; i++) {
+        if (pthread_create(&workers[i], NULL, usage_worker, &job) == 0) {
+            started++;
+        }
+    }
+    if (started == 0) {
+        log_message(doc, "ERROR", "Failed to start usage workers");
+        return -1;
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "Generated %d org reports (%d failures) with %d workers",
+             job.org_count - job.failures, job.failures, started);
+    log_message(doc, job.failures > 0 ? "WARN" : "INFO", msg);
+    return job.failures > 0 ? -1 : 0;
+}
+
 void cleanup_query_usage_doc(QueryUsageDoc *doc) {
     if (doc) {
-        mongoc_collection_destroy(doc->collection);
-        mongoc_client_destroy(doc->client);
+        mongoc_client_pool_destroy(doc->pool);
         mongoc_cleanup();
+        binlog_shutdown();
         fclose(doc->log_file);
         free(doc);
-        log_message(doc, "INFO", "Query usage doc cleanup");
     }
 }
 
@@ -113,10 +483,25 @@ int main() {
     QueryUsageDoc *doc = init_query_usage_doc();
     if (!doc) return 1;
 
-    if (generate_usage_doc(doc, "org123") != 0) {
+    char (*org_ids)[ORG_ID_MAX] = malloc(sizeof(char[MAX_ORGS][ORG_ID_MAX]));
+    if (!org_ids) {
+        cleanup_query_usage_doc(doc);
+        return 1;
+    }
+
+    int org_count = discover_org_ids(doc, org_ids, MAX_ORGS);
+    if (org_count <= 0) {
+        // No orgs discovered (or the command failed): fall back to the old
+        // single-org behaviour so the nightly job still produces something.
+        bson_strncpy(org_ids[0], "org123", ORG_ID_MAX);
+        org_count = 1;
+    }
+
+    if (generate_usage_docs_parallel(doc, org_ids, org_count, 50) != 0) {
         printf("Failed to generate query usage documentation\n");
     }
 
+    free(org_ids);
     cleanup_query_usage_doc(doc);
     return 0;
 }
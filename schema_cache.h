@@ -0,0 +1,176 @@
+#ifndef SCHEMA_CACHE_H
+#define SCHEMA_CACHE_H
+
+/*
+ * Read-through in-process cache over trace_schema_doc.json. Every consumer
+ * that needs the current schema (validator, dispatcher) used to query the
+ * trace_schema collection on startup and on version checks; here the file
+ * generate_schema_doc() already writes is mmapped, parsed once with libbson,
+ * and served from a compact in-memory snapshot. Lookups are lock-free:
+ * snapshots are double-buffered and an atomic index flips between them, so
+ * readers never block while a refresh is in flight. The cache invalidates
+ * itself when the file's mtime changes.
+ */
+
+#include <bson/bson.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SCHEMA_CACHE_FILE "trace_schema_doc.json"
+#define SCHEMA_CACHE_CHECK_INTERVAL_MS 1000
+#define SCHEMA_CACHE_MAX_ATTRS 64
+#define SCHEMA_CACHE_NAME_MAX 64
+#define SCHEMA_CACHE_TYPE_MAX 128
+#define SCHEMA_CACHE_VERSION_MAX 32
+
+typedef struct {
+    char name[SCHEMA_CACHE_NAME_MAX];
+    char type[SCHEMA_CACHE_TYPE_MAX];
+} SchemaAttr;
+
+typedef struct {
+    SchemaAttr attrs[SCHEMA_CACHE_MAX_ATTRS];
+    int attr_count;
+    char version[SCHEMA_CACHE_VERSION_MAX];
+    uint64_t generation;
+} SchemaSnapshot;
+
+static SchemaSnapshot schema_snapshots[2];
+static int schema_current = -1;      /* -1 until the first successful load */
+static int schema_refreshing = 0;    /* CAS guard so only one thread reloads */
+static time_t schema_mtime = 0;
+static uint64_t schema_generation = 0;
+static int64_t schema_last_check_ms = 0;
+
+static int64_t schema_cache_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Builds a snapshot from the mmapped file contents. Returns 0 on success. */
+static int schema_cache_parse(const uint8_t *data, size_t len, SchemaSnapshot *snap) {
+    bson_t *doc = bson_new_from_json(data, (ssize_t)len, NULL);
+    if (!doc) {
+        return -1;
+    }
+
+    memset(snap, 0, sizeof(*snap));
+    bson_iter_t iter;
+    if (bson_iter_init_find(&iter, doc, "version") && BSON_ITER_HOLDS_UTF8(&iter)) {
+        bson_strncpy(snap->version, bson_iter_utf8(&iter, NULL), sizeof(snap->version));
+    }
+
+    bson_iter_t attrs;
+    if (bson_iter_init_find(&iter, doc, "attributes") && bson_iter_recurse(&iter, &attrs)) {
+        while (bson_iter_next(&attrs) && snap->attr_count < SCHEMA_CACHE_MAX_ATTRS) {
+            if (!BSON_ITER_HOLDS_UTF8(&attrs)) {
+                continue;
+            }
+            SchemaAttr *attr = &snap->attrs[snap->attr_count++];
+            bson_strncpy(attr->name, bson_iter_key(&attrs), sizeof(attr->name));
+            bson_strncpy(attr->type, bson_iter_utf8(&attrs, NULL), sizeof(attr->type));
+        }
+    }
+
+    bson_destroy(doc);
+    return 0;
+}
+
+/* Read-through refresh: stat the file, and if its mtime moved past what the
+ * current snapshot was built from, mmap + reparse into the inactive buffer
+ * and flip the atomic index. Concurrent callers that lose the CAS keep
+ * serving the previous snapshot. Callers sit on the per-trace hot path, so
+ * the stat itself is rate-limited: once a snapshot is loaded, the mtime is
+ * rechecked at most every SCHEMA_CACHE_CHECK_INTERVAL_MS. */
+static void schema_cache_refresh(void) {
+    int64_t now = schema_cache_now_ms();
+    if (__atomic_load_n(&schema_current, __ATOMIC_ACQUIRE) >= 0 &&
+        now - __atomic_load_n(&schema_last_check_ms, __ATOMIC_ACQUIRE) < SCHEMA_CACHE_CHECK_INTERVAL_MS) {
+        return;
+    }
+    __atomic_store_n(&schema_last_check_ms, now, __ATOMIC_RELEASE);
+
+    struct stat st;
+    if (stat(SCHEMA_CACHE_FILE, &st) != 0) {
+        return;
+    }
+    if (schema_current >= 0 && st.st_mtime == schema_mtime) {
+        return;
+    }
+
+    int expected = 0;
+    if (!__atomic_compare_exchange_n(&schema_refreshing, &expected, 1, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    int fd = open(SCHEMA_CACHE_FILE, O_RDONLY);
+    if (fd < 0) {
+        __atomic_store_n(&schema_refreshing, 0, __ATOMIC_RELEASE);
+        return;
+    }
+    uint8_t *mapped = (uint8_t *)mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        __atomic_store_n(&schema_refreshing, 0, __ATOMIC_RELEASE);
+        return;
+    }
+
+    int current = __atomic_load_n(&schema_current, __ATOMIC_ACQUIRE);
+    int next = current == 0 ? 1 : 0;
+    if (schema_cache_parse(mapped, (size_t)st.st_size, &schema_snapshots[next]) == 0) {
+        schema_snapshots[next].generation = ++schema_generation;
+        schema_mtime = st.st_mtime;
+        __atomic_store_n(&schema_current, next, __ATOMIC_RELEASE);
+    }
+
+    munmap(mapped, (size_t)st.st_size);
+    __atomic_store_n(&schema_refreshing, 0, __ATOMIC_RELEASE);
+}
+
+static const SchemaSnapshot* schema_cache_snapshot(void) {
+    schema_cache_refresh();
+    int current = __atomic_load_n(&schema_current, __ATOMIC_ACQUIRE);
+    return current < 0 ? NULL : &schema_snapshots[current];
+}
+
+/* Copies the type definition of an attribute into type_out. Returns 0 on a
+ * hit, -1 when the attribute is unknown or no schema file exists yet. */
+static int schema_cache_lookup(const char *attr_name, char *type_out, size_t type_cap) {
+    const SchemaSnapshot *snap = schema_cache_snapshot();
+    if (!snap) {
+        return -1;
+    }
+    for (int i = 0; i < snap->attr_count; i++) {
+        if (strcmp(snap->attrs[i].name, attr_name) == 0) {
+            bson_strncpy(type_out, snap->attrs[i].type, type_cap);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* Copies the cached schema version. Returns 0 on success. */
+static int schema_cache_version(char *version_out, size_t version_cap) {
+    const SchemaSnapshot *snap = schema_cache_snapshot();
+    if (!snap || snap->version[0] == '\0') {
+        return -1;
+    }
+    bson_strncpy(version_out, snap->version, version_cap);
+    return 0;
+}
+
+/* Monotonic generation counter, bumped on every reload; lets callers detect
+ * that the schema changed underneath them without re-reading definitions. */
+static uint64_t schema_cache_generation(void) {
+    const SchemaSnapshot *snap = schema_cache_snapshot();
+    return snap ? snap->generation : 0;
+}
+
+#endif /* SCHEMA_CACHE_H */
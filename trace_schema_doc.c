@@ -5,6 +5,8 @@
 #include <time.h>
 #include <json-c/json.h>
 
+#include "binlog.h"
+
 #define MONGO_URI "mongodb://localhost:27017"
 #define DB_NAME "zero0x_db"
 #define COLLECTION_NAME "trace_schema"
@@ -17,6 +19,10 @@ typedef struct {
 } TraceSchemaDoc;
 
 void log_message(TraceSchemaDoc *doc, const char *level, const char *msg) {
+    if (binlog_ready()) {
+        binlog_write(binlog_level_from_string(level), msg);
+        return;
+    }
     time_t now = time(NULL);
     fprintf(doc->log_file, "[%s] %s: %s\n", ctime(&now), level, msg);
     fflush(doc->log_file);
@@ -34,6 +40,7 @@ TraceSchemaDoc* init_trace_schema_doc() {
         free(doc);
         return NULL;
     }
+    binlog_init("trace_schema_doc.binlog");
 
     mongoc_init();
     doc->client = mongoc_client_new(MONGO_URI);
@@ -108,6 +115,7 @@ void cleanup_trace_schema_doc(TraceSchemaDoc *doc) {
         mongoc_collection_destroy(doc->collection);
         mongoc_client_destroy(doc->client);
         mongoc_cleanup();
+        binlog_shutdown();
         fclose(doc->log_file);
         free(doc);
         log_message(doc, "INFO", "Trace schema doc cleanup");